@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+
+namespace fsmc {
+// Durations in HCLK cycles, as in the BTRx/BWTRx registers
+struct Timings {
+  static constexpr std::uint8_t ADDRESS_SETUP_MIN{0};
+  static constexpr std::uint8_t ADDRESS_HOLD_MIN{1};
+  static constexpr std::uint8_t DATA_SETUP_MIN{1};
+
+  std::uint8_t address_setup;
+  std::uint8_t address_hold;
+  std::uint8_t data_setup;
+
+  [[nodiscard]] constexpr std::uint32_t ToRegister() const noexcept {
+    return static_cast<std::uint32_t>(address_setup) |
+           static_cast<std::uint32_t>(address_hold) << 4 |
+           static_cast<std::uint32_t>(data_setup) << 8;
+  }
+
+  constexpr bool operator==(const Timings& other) const noexcept {
+    return address_setup == other.address_setup &&
+           address_hold == other.address_hold &&
+           data_setup == other.data_setup;
+  }
+
+  constexpr bool operator!=(const Timings& other) const noexcept {
+    return !(*this == other);
+  }
+};
+
+namespace details {
+template <class Probe>
+std::uint8_t find_minimal(Probe& probe,
+                          const Timings& reference,
+                          std::uint8_t Timings::*field,
+                          std::uint8_t min_value) noexcept {
+  Timings candidate{reference};
+  for (std::uint8_t value = min_value; value < reference.*field; ++value) {
+    candidate.*field = value;
+    if (probe(candidate)) {
+      return value;
+    }
+  }
+  return reference.*field;
+}
+
+constexpr std::uint8_t step_towards(std::uint8_t value,
+                                    std::uint8_t limit,
+                                    std::uint8_t step) noexcept {
+  return static_cast<std::uint8_t>(
+      value + step < limit ? value + step : limit);
+}
+
+constexpr Timings step_towards(const Timings& timings,
+                               const Timings& limit,
+                               std::uint8_t step) noexcept {
+  return {step_towards(timings.address_setup, limit.address_setup, step),
+          step_towards(timings.address_hold, limit.address_hold, step),
+          step_towards(timings.data_setup, limit.data_setup, step)};
+}
+}  // namespace details
+
+// Looks for the fastest timings the probe verifies. The probe is a
+// callable bool(const Timings&) that applies the timings and checks the
+// bus, so the search itself doesn't touch the hardware.
+//
+// Every field is lowered separately from the known-good reference,
+// starting from its minimum, then the combination is relaxed until it
+// verifies and `margin` cycles are added. Returns nullopt if even the
+// reference doesn't verify, i.e. the check can't be trusted.
+template <class Probe>
+std::optional<Timings> CalibrateTimings(Probe&& probe,
+                                        const Timings& reference,
+                                        std::uint8_t margin) noexcept {
+  if (!probe(reference)) {
+    return std::nullopt;
+  }
+
+  Timings fastest{
+      details::find_minimal(probe, reference, &Timings::address_setup,
+                            Timings::ADDRESS_SETUP_MIN),
+      details::find_minimal(probe, reference, &Timings::address_hold,
+                            Timings::ADDRESS_HOLD_MIN),
+      details::find_minimal(probe, reference, &Timings::data_setup,
+                            Timings::DATA_SETUP_MIN)};
+  while (fastest != reference && !probe(fastest)) {
+    fastest = details::step_towards(fastest, reference, 1);
+  }
+
+  const Timings chosen{details::step_towards(fastest, reference, margin)};
+  return probe(chosen) ? chosen : reference;
+}
+}  // namespace fsmc
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "color.hpp"
+
+#include <stm32f4xx.h>
+
+#include <array>
+#include <cstring>
+
+using namespace std;
+
+namespace color {
+namespace details {
+template <uint32_t Shift>
+uint32_t pack_bottom_top(uint32_t bottom, uint32_t top) noexcept {
+#if defined(__ARM_FEATURE_DSP)
+  return __PKHBT(bottom, top, Shift);
+#else
+  return (bottom & 0x0000FFFF) | ((top << Shift) & 0xFFFF0000);
+#endif
+}
+
+template <uint32_t Shift>
+uint32_t rotate_right(uint32_t value) noexcept {
+#if defined(__ARM_FEATURE_DSP)
+  return __ROR(value, Shift);
+#else
+  return value >> Shift | value << (32 - Shift);
+#endif
+}
+
+template <class Ty>
+uint32_t load_word(const Ty* from) noexcept {
+  uint32_t word;
+  memcpy(addressof(word), from, sizeof(word));
+  return word;
+}
+
+template <class Ty>
+void store_word(Ty* to, uint32_t word) noexcept {
+  memcpy(to, addressof(word), sizeof(word));
+}
+}  // namespace details
+
+void ToRgb666(const bmp::Bgr888* pixels,
+              size_t count,
+              bmp::Rgb666* out) noexcept {
+  static_assert(sizeof(bmp::Bgr888) == 3 && sizeof(bmp::Rgb666) == 4);
+
+  // Output pixel as a little-endian word: G, R, 0, B (each masked to 6 bits)
+  constexpr uint32_t OUTPUT_MASK{0xFC00FCFC};
+  constexpr size_t PIXELS_PER_STEP{4};
+
+  const auto* input{reinterpret_cast<const uint8_t*>(pixels)};
+  for (; count >= PIXELS_PER_STEP; count -= PIXELS_PER_STEP) {
+    // w0 = B0 G0 R0 B1, w1 = G1 R1 B2 G2, w2 = R2 B3 G3 R3
+    const uint32_t w0{details::load_word(input)};
+    const uint32_t w1{details::load_word(input + 4)};
+    const uint32_t w2{details::load_word(input + 8)};
+    input += PIXELS_PER_STEP * sizeof(bmp::Bgr888);
+
+    const array<uint32_t, PIXELS_PER_STEP> words{
+        details::pack_bottom_top<24>(w0 >> 8, w0),
+        details::pack_bottom_top<0>(w1, w0),
+        details::pack_bottom_top<8>(w1 >> 24 | w2 << 8, w1),
+        details::rotate_right<16>(w2)};
+    for (const uint32_t word : words) {
+      details::store_word(out++, word & OUTPUT_MASK);
+    }
+  }
+
+  const auto* tail{reinterpret_cast<const bmp::Bgr888*>(input)};
+  while (count--) {
+    *out++ = ToRgb666(*tail++);
+  }
+}
+
+void ToRgb565(const bmp::Bgr888* pixels,
+              size_t count,
+              bmp::Rgb565* out) noexcept {
+  // One output word per pixel, the scalar packing is already branch-free
+  while (count--) {
+    *out++ = ToRgb565(*pixels++);
+  }
+}
+}  // namespace color
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include <filesystem/bmp.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace color {
+// RGB666 in the layout ColorCompressor produces for the 16-bit bus in the
+// 18-bit mode: R5..R0 in D15..D10 and G5..G0 in D7..D2 of the first word,
+// B5..B0 in D15..D10 of the second one
+constexpr bmp::Rgb666 ToRgb666(bmp::Bgr888 pixel) noexcept {
+  constexpr std::uint8_t CHANNEL_MASK{0xFC};
+  return {static_cast<std::uint16_t>((pixel.red & CHANNEL_MASK) << 8 |
+                                     (pixel.green & CHANNEL_MASK)),
+          static_cast<std::uint16_t>((pixel.blue & CHANNEL_MASK) << 8)};
+}
+
+constexpr bmp::Rgb666 ToRgb666(bmp::Rgb565 pixel) noexcept {
+  const auto red{static_cast<std::uint16_t>(pixel.value >> 8 & 0xF8)};
+  const auto green{static_cast<std::uint16_t>(pixel.value >> 3 & 0xFC)};
+  const auto blue{static_cast<std::uint16_t>(pixel.value << 3 & 0xF8)};
+  return {static_cast<std::uint16_t>(red << 8 | green),
+          static_cast<std::uint16_t>(blue << 8)};
+}
+
+constexpr bmp::Rgb565 ToRgb565(bmp::Bgr888 pixel) noexcept {
+  return {static_cast<std::uint16_t>((pixel.red & 0xF8) << 8 |
+                                     (pixel.green & 0xFC) << 3 |
+                                     pixel.blue >> 3)};
+}
+
+constexpr bmp::Rgb565 ToRgb565(bmp::Rgb666 pixel) noexcept {
+  return ToRgb565(bmp::Bgr888{static_cast<std::uint8_t>(pixel.blue >> 8),
+                              static_cast<std::uint8_t>(pixel.red_green),
+                              static_cast<std::uint8_t>(pixel.red_green >> 8)});
+}
+
+// Low bits are replicated, so the peer gets the full range back
+constexpr bmp::Bgr888 ToBgr888(bmp::Rgb565 pixel) noexcept {
+  const auto red{static_cast<std::uint8_t>(pixel.value >> 11)};
+  const auto green{static_cast<std::uint8_t>(pixel.value >> 5 & 0x3F)};
+  const auto blue{static_cast<std::uint8_t>(pixel.value & 0x1F)};
+  return {static_cast<std::uint8_t>(blue << 3 | blue >> 2),
+          static_cast<std::uint8_t>(green << 2 | green >> 4),
+          static_cast<std::uint8_t>(red << 3 | red >> 2)};
+}
+
+// Bit-exact with the scalar ToRgb666() above, but handles 4 pixels
+// (3 input words) per iteration using the Cortex-M4 DSP pack instructions
+void ToRgb666(const bmp::Bgr888* pixels,
+              std::size_t count,
+              bmp::Rgb666* out) noexcept;
+
+void ToRgb565(const bmp::Bgr888* pixels,
+              std::size_t count,
+              bmp::Rgb565* out) noexcept;
+}  // namespace color
\ No newline at end of file
@@ -1,17 +1,59 @@
 #include "display.hpp"
+#include "color.hpp"
 
+#include <algorithm>
 #include <array>
 
 using namespace std;
 
 namespace pv {
+namespace {
+constexpr size_t CONVERSION_CHUNK_WORDS{32};
+
+void write_as_rgb565(lcd::Panel& lcd,
+                     const bmp::Rgb666* pixels,
+                     size_t count) noexcept {
+  array<uint16_t, CONVERSION_CHUNK_WORDS> words;
+  while (count > 0) {
+    const size_t chunk{min(count, size(words))};
+    for (size_t idx = 0; idx < chunk; ++idx) {
+      words[idx] = color::ToRgb565(pixels[idx]).value;
+    }
+    lcd.WriteBurst(data(words), chunk);
+    pixels += chunk;
+    count -= chunk;
+  }
+}
+
+void write_as_rgb666(lcd::Panel& lcd,
+                     const bmp::Rgb565* pixels,
+                     size_t count) noexcept {
+  array<bmp::Rgb666, CONVERSION_CHUNK_WORDS / 2> chunk_pixels;
+  while (count > 0) {
+    const size_t chunk{min(count, size(chunk_pixels))};
+    for (size_t idx = 0; idx < chunk; ++idx) {
+      chunk_pixels[idx] = color::ToRgb666(pixels[idx]);
+    }
+    lcd.WriteBurst(reinterpret_cast<const uint16_t*>(data(chunk_pixels)),
+                   chunk * 2);
+    pixels += chunk;
+    count -= chunk;
+  }
+}
+}  // namespace
+
 Display::Display() noexcept {
   auto& lcd{lcd::Panel::GetInstance()};
   lcd.SendCommand(lcd::Command::WakeUp);
+  lcd.SetScrollArea(0, lcd::Panel::GRAM_LINES, 0).SetScrollStart(0);
   setup_18bit_color(lcd);
+  if constexpr (CALIBRATE_BUS_TIMINGS) {
+    lcd.CalibrateWriteTimings();
+  }
 }
 
 void Display::Show(bool on) {
+  wait_for_transfer();
   auto& lcd{lcd::Panel::GetInstance()};
   lcd.BackLightControl(on);
   if (on) {
@@ -21,13 +63,145 @@ void Display::Show(bool on) {
   }
 }
 
+void Display::SetColorFormat(ColorFormat format) noexcept {
+  wait_for_transfer();
+  auto& lcd{lcd::Panel::GetInstance()};
+  if (format == ColorFormat::Rgb565) {
+    setup_16bit_color(lcd);
+  } else {
+    setup_18bit_color(lcd);
+  }
+  m_format = format;
+}
+
+ColorFormat Display::GetColorFormat() const noexcept {
+  return m_format;
+}
+
+void Display::SetOrientation(lcd::Orientation orientation) noexcept {
+  wait_for_transfer();
+  lcd::Panel::GetInstance().SetOrientation(orientation);
+}
+
+lcd::Orientation Display::GetOrientation() const noexcept {
+  return lcd::Panel::GetInstance().GetOrientation();
+}
+
 void Display::Refresh() noexcept {
-  lcd::Panel::GetInstance().SendCommand(lcd::Command::WriteMemory);
+  SetWindow(0, 0, lcd::Panel::PIXEL_HORIZONTAL - 1,
+            lcd::Panel::PIXEL_VERTICAL - 1);
+}
+
+void Display::SetWindow(uint16_t x0,
+                        uint16_t y0,
+                        uint16_t x1,
+                        uint16_t y1) noexcept {
+  wait_for_transfer();
+  lcd::Panel::GetInstance()
+      .SetColumns(x0, x1)
+      .SetRows(y0, y1)
+      .SendCommand(lcd::Command::WriteMemory);
+}
+
+void Display::SetWindow(const Rect& window) noexcept {
+  SetWindow(window.x0, window.y0, window.x1, window.y1);
+}
+
+void Display::Fill(const Rect& area, bmp::Rgb666 color) noexcept {
+  array<bmp::Rgb666, lcd::Panel::PIXEL_HORIZONTAL> row;
+  fill_n(begin(row), area.GetWidth(), color);
+
+  SetWindow(area);
+  for (size_t idx = 0; idx < area.GetHeight(); ++idx) {
+    DrawSpan(data(row), area.GetWidth());
+  }
+}
+
+void Display::Clear() noexcept {
+  Fill(Rect::Screen(), bmp::Rgb666{});
+}
+
+void Display::Scroll(uint16_t start_line) noexcept {
+  wait_for_transfer();
+  lcd::Panel::GetInstance().SetScrollStart(start_line);
 }
 
 void Display::Draw(bmp::Rgb666 pixel) noexcept {
-  const array color{pixel.red_green, pixel.blue};
-  lcd::Panel::GetInstance().Write(data(color), size(color));
+  wait_for_transfer();
+  auto& lcd{lcd::Panel::GetInstance()};
+  if (m_format == ColorFormat::Rgb565) {
+    lcd.Write(color::ToRgb565(pixel).value);
+  } else {
+    const array color{pixel.red_green, pixel.blue};
+    lcd.Write(data(color), size(color));
+  }
+}
+
+void Display::DrawSpan(const bmp::Rgb666* pixels, size_t count) noexcept {
+  static_assert(sizeof(bmp::Rgb666) == 2 * sizeof(uint16_t),
+                "pixel must be a pair of bus words");
+  wait_for_transfer();
+  auto& lcd{lcd::Panel::GetInstance()};
+  if (m_format == ColorFormat::Rgb565) {
+    write_as_rgb565(lcd, pixels, count);
+  } else {
+    lcd.WriteBurst(reinterpret_cast<const uint16_t*>(pixels), count * 2);
+  }
+}
+
+void Display::DrawSpan(const bmp::Rgb565* pixels, size_t count) noexcept {
+  static_assert(sizeof(bmp::Rgb565) == sizeof(uint16_t),
+                "pixel must be a bus word");
+  wait_for_transfer();
+  auto& lcd{lcd::Panel::GetInstance()};
+  if (m_format == ColorFormat::Rgb565) {
+    lcd.WriteBurst(reinterpret_cast<const uint16_t*>(pixels), count);
+  } else {
+    write_as_rgb666(lcd, pixels, count);
+  }
+}
+
+void Display::DrawAsync(const bmp::Rgb666* pixels,
+                        size_t count,
+                        dma::completion_t callback,
+                        void* context) noexcept {
+  if (m_format == ColorFormat::Rgb666) {
+    start_transfer(reinterpret_cast<const uint16_t*>(pixels), count * 2,
+                   callback, context);
+  } else {
+    DrawSpan(pixels, count);
+    if (callback) {
+      callback(context, true);
+    }
+  }
+}
+
+void Display::DrawAsync(const bmp::Rgb565* pixels,
+                        size_t count,
+                        dma::completion_t callback,
+                        void* context) noexcept {
+  if (m_format == ColorFormat::Rgb565) {
+    start_transfer(reinterpret_cast<const uint16_t*>(pixels), count, callback,
+                   context);
+  } else {
+    DrawSpan(pixels, count);
+    if (callback) {
+      callback(context, true);
+    }
+  }
+}
+
+void Display::wait_for_transfer() noexcept {
+  dma::MemoryStream::GetInstance().Wait();
+}
+
+void Display::start_transfer(const uint16_t* words,
+                             size_t count,
+                             dma::completion_t callback,
+                             void* context) noexcept {
+  dma::MemoryStream::GetInstance().Start(
+      words, lcd::Panel::GetInstance().GetDataPort(), count, callback,
+      context);
 }
 
 void Display::setup_18bit_color(lcd::Panel& lcd) noexcept {
@@ -37,4 +211,8 @@ void Display::setup_18bit_color(lcd::Panel& lcd) noexcept {
       .SendCommand(lcd::Command::ColorMode)
       .Write(0b00000110);
 }
+
+void Display::setup_16bit_color(lcd::Panel& lcd) noexcept {
+  lcd.SendCommand(lcd::Command::ColorMode).Write(0b00000101);
+}
 }  // namespace pv
\ No newline at end of file
@@ -1,22 +1,74 @@
 #pragma once
 #include "lcd.hpp"
+#include "region.hpp"
 
 #include <filesystem/bmp.hpp>
+#include <platform/dma.hpp>
 #include <tools/singleton.hpp>
 
+#include <cstddef>
 #include <cstdint>
 
 namespace pv {
+// 18-bit color takes two bus writes per pixel, 16-bit color takes one
+enum class ColorFormat { Rgb666, Rgb565 };
+
 class Display : public pv::Singleton<Display> {
+ public:
+  static constexpr std::size_t MAX_ASYNC_PIXELS{
+      dma::MemoryStream::MAX_TRANSFER_LENGTH / 2};
+
+  // Looks for faster FSMC write timings at startup
+  static constexpr bool CALIBRATE_BUS_TIMINGS{true};
+
  public:
   void Show(bool on);
+  // GRAM content isn't converted, so the screen has to be redrawn
+  void SetColorFormat(ColorFormat format) noexcept;
+  [[nodiscard]] ColorFormat GetColorFormat() const noexcept;
+  // Windows drawn afterwards are mapped onto GRAM in the new orientation
+  void SetOrientation(lcd::Orientation orientation) noexcept;
+  [[nodiscard]] lcd::Orientation GetOrientation() const noexcept;
   void Refresh() noexcept;
+  void SetWindow(std::uint16_t x0,
+                 std::uint16_t y0,
+                 std::uint16_t x1,
+                 std::uint16_t y1) noexcept;
+  void SetWindow(const Rect& window) noexcept;
+  void Fill(const Rect& area, bmp::Rgb666 color) noexcept;
+  void Clear() noexcept;
+  // The whole GRAM is scrolled, screen line 0 shows the start line
+  void Scroll(std::uint16_t start_line) noexcept;
   void Draw(bmp::Rgb666 pixel) noexcept;
+  // Pixels in the other format are converted on the fly
+  void DrawSpan(const bmp::Rgb666* pixels, std::size_t count) noexcept;
+  void DrawSpan(const bmp::Rgb565* pixels, std::size_t count) noexcept;
+
+  // Returns as soon as the DMA transfer is started, the pixels must stay
+  // alive until the callback. Other drawing waits for the transfer.
+  // Pixels in the other format are drawn synchronously.
+  void DrawAsync(const bmp::Rgb666* pixels,
+                 std::size_t count,
+                 dma::completion_t callback = nullptr,
+                 void* context = nullptr) noexcept;
+  void DrawAsync(const bmp::Rgb565* pixels,
+                 std::size_t count,
+                 dma::completion_t callback = nullptr,
+                 void* context = nullptr) noexcept;
 
  private:
   friend Singleton;
 
   Display() noexcept;
+  static void wait_for_transfer() noexcept;
+  static void start_transfer(const std::uint16_t* words,
+                             std::size_t count,
+                             dma::completion_t callback,
+                             void* context) noexcept;
   static void setup_18bit_color(lcd::Panel& lcd) noexcept;
+  static void setup_16bit_color(lcd::Panel& lcd) noexcept;
+
+ private:
+  ColorFormat m_format{ColorFormat::Rgb666};
 };
 }  // namespace pv
\ No newline at end of file
@@ -41,7 +41,7 @@ class NorSram : public details::MemoryBank<Ty> {
  public:
   constexpr explicit NorSram(volatile Ty* address,
                              config_t& config,
-                             write_timings_t write_timings) noexcept
+                             write_timings_t& write_timings) noexcept
       : MyBase(address),
         m_config{std::addressof(config)},
         m_write_timings{std::addressof(write_timings)} {}
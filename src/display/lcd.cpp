@@ -54,16 +54,109 @@ Panel& Panel::Write(const uint16_t* values, size_t count) noexcept {
   return *this;
 }
 
+Panel& Panel::WriteBurst(const uint16_t* values, size_t count) noexcept {
+  constexpr size_t UNROLL_FACTOR{8};
+
+  volatile uint16_t& port{m_bus[DATA_IDX]};
+  for (; count >= UNROLL_FACTOR; count -= UNROLL_FACTOR) {
+    port = values[0];
+    port = values[1];
+    port = values[2];
+    port = values[3];
+    port = values[4];
+    port = values[5];
+    port = values[6];
+    port = values[7];
+    values += UNROLL_FACTOR;
+  }
+  while (count--) {
+    port = *values++;
+  }
+  return *this;
+}
+
+volatile uint16_t* Panel::GetDataPort() noexcept {
+  return addressof(m_bus[DATA_IDX]);
+}
+
+Panel& Panel::SetOrientation(Orientation orientation) noexcept {
+  const uint8_t value{orientation.ToMadCtl()};
+  SendCommand(Command::MemoryAccessControl);
+  Write(value);
+  constexpr uint16_t hidden_lines{GRAM_LINES - PIXEL_VERTICAL};
+  const bool reversed_lines{(value & Orientation::ROW_ORDER) != 0};
+  const bool exchanged{(value & Orientation::EXCHANGE) != 0};
+  m_column_offset = reversed_lines && exchanged ? hidden_lines : 0;
+  m_row_offset = reversed_lines && !exchanged ? hidden_lines : 0;
+  m_orientation = orientation;
+  return *this;
+}
+
+Orientation Panel::GetOrientation() const noexcept {
+  return m_orientation;
+}
+
+Panel& Panel::SetColumns(uint16_t first, uint16_t last) noexcept {
+  SendCommand(Command::SetColumn);
+  write_range(static_cast<uint16_t>(first + m_column_offset),
+              static_cast<uint16_t>(last + m_column_offset));
+  return *this;
+}
+
+Panel& Panel::SetRows(uint16_t first, uint16_t last) noexcept {
+  SendCommand(Command::SetRow);
+  write_range(static_cast<uint16_t>(first + m_row_offset),
+              static_cast<uint16_t>(last + m_row_offset));
+  return *this;
+}
+
 auto Panel::GetId() const noexcept -> const Id& {
   return m_id;
 }
 
+Panel& Panel::SetScrollArea(uint16_t top_fixed,
+                            uint16_t scrolled,
+                            uint16_t bottom_fixed) noexcept {
+  SendCommand(Command::VerticalScrollDefinition);
+  write_parameter(top_fixed);
+  write_parameter(scrolled);
+  write_parameter(bottom_fixed);
+  return *this;
+}
+
+Panel& Panel::SetScrollStart(uint16_t line) noexcept {
+  SendCommand(Command::VerticalScrollStart);
+  write_parameter(line);
+  return *this;
+}
+
+optional<fsmc::Timings> Panel::CalibrateWriteTimings() noexcept {
+  const auto timings{fsmc::CalibrateTimings(
+      [this](const fsmc::Timings& candidate) {
+        return verify_write_timings(candidate);
+      },
+      REFERENCE_TIMINGS, CALIBRATION_MARGIN)};
+  apply_write_timings(timings.value_or(REFERENCE_TIMINGS));
+  return timings;
+}
+
 void Panel::skip(size_t skip_count) const noexcept {
   while (skip_count--) {
     [[maybe_unused]] const uint16_t dummy_value{m_bus[DATA_IDX]};
   }
 }
 
+void Panel::write_parameter(uint16_t value) noexcept {
+  // 16-bit parameters are passed as big-endian bytes
+  Write(value >> 8).Write(value & 0xFF);
+}
+
+void Panel::write_range(uint16_t first, uint16_t last) noexcept {
+  // CASET/RASET take SC/SP or SR/ER
+  write_parameter(first);
+  write_parameter(last);
+}
+
 void Panel::read_id() noexcept {
   std::array<uint16_t, 3> raw_id;
   SendCommand(Command::ReadId);
@@ -71,10 +164,67 @@ void Panel::read_id() noexcept {
   m_id = parse_id(raw_id);
 }
 
+void Panel::apply_write_timings(const fsmc::Timings& timings) noexcept {
+  auto& write_timings{m_bus.GetWriteTimings().BWTR[0]};
+  write_timings =
+      (write_timings & BUS_TIMINGS_RESERVED_MASK) | timings.ToRegister();
+  SET_BIT(m_bus.GetConfig().BTCR[0], FSMC_BCR1_EXTMOD);
+}
+
+bool Panel::verify_write_timings(const fsmc::Timings& timings) noexcept {
+  for (uint8_t idx = 0; idx < CALIBRATION_REPEATS; ++idx) {
+    if (!verify_pattern(timings)) {
+      apply_write_timings(REFERENCE_TIMINGS);
+      return false;
+    }
+  }
+  apply_write_timings(REFERENCE_TIMINGS);
+  return true;
+}
+
+bool Panel::verify_pattern(const fsmc::Timings& timings) noexcept {
+  // 6-bit channels with alternating bits. RAMRD returns one byte per
+  // channel, so two pixels take three words.
+  static constexpr array<uint8_t, 4> CHANNELS{0xFC, 0x00, 0xA8, 0x54};
+  constexpr size_t CHANNELS_COUNT{CALIBRATION_PIXELS * 3};
+  constexpr auto channel{[](size_t idx) {
+    return static_cast<uint16_t>(CHANNELS[idx % size(CHANNELS)]);
+  }};
+
+  // A broken command could put the panel into an unknown state, so only
+  // the pixels are written with the candidate timings
+  apply_write_timings(REFERENCE_TIMINGS);
+  SetColumns(0, CALIBRATION_PIXELS - 1)
+      .SetRows(0, 0)
+      .SendCommand(Command::WriteMemory);
+  apply_write_timings(timings);
+  for (size_t idx = 0; idx < CHANNELS_COUNT; idx += 3) {
+    Write(static_cast<uint16_t>(channel(idx) << 8 | channel(idx + 1)))
+        .Write(static_cast<uint16_t>(channel(idx + 2) << 8));
+  }
+
+  apply_write_timings(REFERENCE_TIMINGS);
+  SetColumns(0, CALIBRATION_PIXELS - 1)
+      .SetRows(0, 0)
+      .SendCommand(Command::ReadMemory);
+  array<uint16_t, CHANNELS_COUNT / 2> words;
+  Read(data(words), size(words), 1);
+
+  for (size_t idx = 0; idx < size(words); ++idx) {
+    const auto expected{
+        static_cast<uint16_t>(channel(2 * idx) << 8 | channel(2 * idx + 1))};
+    if ((words[idx] & 0xFCFC) != expected) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void Panel::initialize() noexcept {
   SendCommand(Command::ColorMode);
   Write(0x5);  // 16-bit color (RGB565)
   SendCommand(Command::InversionOn);
+  SetOrientation(m_orientation);
 }
 
 auto Panel::setup_bus() noexcept -> bus_t {
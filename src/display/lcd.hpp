@@ -1,4 +1,5 @@
 #pragma once
+#include "calibration.hpp"
 #include "fsmc.hpp"
 
 #include <tools/singleton.hpp>
@@ -6,6 +7,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 
 namespace lcd {
 enum class Command : uint16_t {
@@ -30,16 +32,74 @@ enum class Command : uint16_t {
   SetColumn = 0x2A,    // CASET
   SetRow = 0x2B,       // RASET
   WriteMemory = 0x2C,  // RAMWR
-  ColorMode = 0x3A,    // COLMOD
+  ReadMemory = 0x2E,   // RAMRD
+
+  VerticalScrollDefinition = 0x33,  // VSCRDEF
+  TearingEffectOff = 0x34,          // TEOFF
+  TearingEffectOn = 0x35,           // TEON
+  MemoryAccessControl = 0x36,       // MADCTL
+  VerticalScrollStart = 0x37,       // VSCSAD
+
+  ColorMode = 0x3A,  // COLMOD
 
   RamControl = 0xB0,  // RAMCTRL
 };
 
+enum class Rotation : uint8_t { Deg0, Deg90, Deg180, Deg270 };
+
+// Maps the window coordinates onto GRAM in hardware (MADCTL): the address
+// space is rotated clockwise, mirroring flips the columns afterwards
+struct Orientation {
+  static constexpr uint8_t ROW_ORDER{0x80};     // MY
+  static constexpr uint8_t COLUMN_ORDER{0x40};  // MX
+  static constexpr uint8_t EXCHANGE{0x20};      // MV
+
+  Rotation rotation{Rotation::Deg0};
+  bool mirrored{false};
+
+  [[nodiscard]] constexpr uint8_t ToMadCtl() const noexcept {
+    uint8_t value{0};
+    switch (rotation) {
+      case Rotation::Deg0:
+        break;
+      case Rotation::Deg90:
+        value = COLUMN_ORDER | EXCHANGE;
+        break;
+      case Rotation::Deg180:
+        value = COLUMN_ORDER | ROW_ORDER;
+        break;
+      case Rotation::Deg270:
+        value = ROW_ORDER | EXCHANGE;
+        break;
+    }
+    if (mirrored) {
+      // The columns are GRAM rows once the axes are exchanged
+      value ^= (value & EXCHANGE) ? ROW_ORDER : COLUMN_ORDER;
+    }
+    return value;
+  }
+
+  // Window rows are GRAM lines in their order, as the panel scans them
+  [[nodiscard]] constexpr bool KeepsLineOrder() const noexcept {
+    return !(ToMadCtl() & (ROW_ORDER | EXCHANGE));
+  }
+
+  constexpr bool operator==(const Orientation& other) const noexcept {
+    return ToMadCtl() == other.ToMadCtl();
+  }
+
+  constexpr bool operator!=(const Orientation& other) const noexcept {
+    return !(*this == other);
+  }
+};
+
 class Panel : public pv::Singleton<Panel> {
  public:
   static constexpr uint16_t PIXEL_VERTICAL{240};
   static constexpr uint16_t PIXEL_HORIZONTAL{240};
   static constexpr uint16_t PIXEL_COUNT{PIXEL_VERTICAL * PIXEL_HORIZONTAL};
+  // GRAM is taller than the panel, the rest lines are hidden
+  static constexpr uint16_t GRAM_LINES{320};
 
   struct Id {
     uint8_t manufacturer;
@@ -63,6 +123,13 @@ class Panel : public pv::Singleton<Panel> {
   static constexpr uint32_t BUS_TIMINGS{0x00000326};
   static constexpr uint32_t BUS_TIMINGS_RESERVED_MASK{0xC0000000};
 
+  // Reads keep BUS_TIMINGS, the write timings are calibrated
+  static constexpr fsmc::Timings REFERENCE_TIMINGS{6, 2, 3};
+  static_assert(REFERENCE_TIMINGS.ToRegister() == BUS_TIMINGS);
+  static constexpr uint8_t CALIBRATION_MARGIN{1};
+  static constexpr uint8_t CALIBRATION_REPEATS{4};
+  static constexpr uint16_t CALIBRATION_PIXELS{8};
+
  public:
   void BackLightControl(bool on) const noexcept;
 
@@ -76,16 +143,44 @@ class Panel : public pv::Singleton<Panel> {
 
   Panel& Write(std::uint16_t value) noexcept;
   Panel& Write(const std::uint16_t* values, std::size_t count) noexcept;
+  // Streams values straight into the data port, meant for whole GRAM rows
+  Panel& WriteBurst(const std::uint16_t* values, std::size_t count) noexcept;
+
+  // Target for DMA transfers
+  [[nodiscard]] volatile std::uint16_t* GetDataPort() noexcept;
+
+  // Applies to the next windows, GRAM content stays as it is
+  Panel& SetOrientation(Orientation orientation) noexcept;
+  [[nodiscard]] Orientation GetOrientation() const noexcept;
+
+  Panel& SetColumns(std::uint16_t first, std::uint16_t last) noexcept;
+  Panel& SetRows(std::uint16_t first, std::uint16_t last) noexcept;
+
+  // Lines of the scroll area wrap around, the fixed areas stay in place
+  Panel& SetScrollArea(std::uint16_t top_fixed,
+                       std::uint16_t scrolled,
+                       std::uint16_t bottom_fixed) noexcept;
+  Panel& SetScrollStart(std::uint16_t line) noexcept;
 
   [[nodiscard]] const Id& GetId() const noexcept;
 
+  // Finds the fastest write timings that keep a GRAM test pattern intact,
+  // expects the 18-bit color mode. Returns nullopt and keeps the reference
+  // timings if the pattern can't be read back.
+  std::optional<fsmc::Timings> CalibrateWriteTimings() noexcept;
+
  private:
   friend Singleton;
 
   Panel() noexcept;
 
   void skip(std::size_t skip_count) const noexcept;
+  void write_parameter(std::uint16_t value) noexcept;
+  void write_range(std::uint16_t first, std::uint16_t last) noexcept;
   void read_id() noexcept;
+  void apply_write_timings(const fsmc::Timings& timings) noexcept;
+  bool verify_write_timings(const fsmc::Timings& timings) noexcept;
+  bool verify_pattern(const fsmc::Timings& timings) noexcept;
   void initialize() noexcept;
 
   static bus_t setup_bus() noexcept;
@@ -96,5 +191,9 @@ class Panel : public pv::Singleton<Panel> {
  private:
   bus_t m_bus;
   Id m_id;
+  Orientation m_orientation{};
+  // Reversed GRAM lines start from the hidden ones
+  std::uint16_t m_column_offset{0};
+  std::uint16_t m_row_offset{0};
 };
 }  // namespace lcd
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "osd.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace osd {
+namespace {
+using glyph_columns_t = array<uint8_t, GLYPH_WIDTH>;
+using glyph_t = array<uint8_t, GLYPH_HEIGHT>;
+
+constexpr char FIRST_CHAR{' '};
+constexpr char LAST_CHAR{'_'};
+constexpr char FALLBACK_CHAR{'?'};
+
+// The classic 5x7 font for ' '..'_', a byte per column with bit 0 on top
+constexpr array<glyph_columns_t, LAST_CHAR - FIRST_CHAR + 1> GLYPH_COLUMNS{{
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00},
+    {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00},
+    {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08},
+    {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39},
+    {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E},
+    {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+    {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E},
+    {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41},
+    {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x49, 0x49, 0x7A},
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x0C, 0x02, 0x7F},
+    {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E},
+    {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F},
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07},
+    {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00},
+    {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+}};
+
+// Transposed at compile time, so a glyph row is a single load with the
+// leftmost pixel in the highest bit
+constexpr auto make_font() noexcept {
+  array<glyph_t, size(GLYPH_COLUMNS)> font{};
+  for (size_t idx = 0; idx < size(font); ++idx) {
+    for (size_t row = 0; row < GLYPH_HEIGHT; ++row) {
+      for (size_t column = 0; column < GLYPH_WIDTH; ++column) {
+        if (GLYPH_COLUMNS[idx][column] >> row & 1) {
+          font[idx][row] = static_cast<uint8_t>(
+              font[idx][row] | 1 << (GLYPH_WIDTH - 1 - column));
+        }
+      }
+    }
+  }
+  return font;
+}
+
+constexpr auto FONT{make_font()};
+static_assert(FONT['A' - FIRST_CHAR][0] == 0b01110);
+static_assert(FONT['A' - FIRST_CHAR][GLYPH_HEIGHT - 1] == 0b10001);
+static_assert(lcd::Panel::PIXEL_HORIZONTAL % SCALE == 0);
+
+constexpr char normalize(char ch) noexcept {
+  if (ch >= 'a' && ch <= 'z') {
+    return static_cast<char>(ch - 'a' + 'A');
+  }
+  return ch >= FIRST_CHAR && ch <= LAST_CHAR ? ch : FALLBACK_CHAR;
+}
+
+bool is_ink(const text_t& text, size_t row, size_t column) noexcept {
+  if (column < GLYPH_SPACING) {
+    return false;
+  }
+  column -= GLYPH_SPACING;
+  const size_t char_idx{column / (GLYPH_WIDTH + GLYPH_SPACING)};
+  const size_t offset{column % (GLYPH_WIDTH + GLYPH_SPACING)};
+  if (char_idx >= MAX_CHARS || !text[char_idx] || offset >= GLYPH_WIDTH) {
+    return false;
+  }
+  const glyph_t& glyph{FONT[normalize(text[char_idx]) - FIRST_CHAR]};
+  return glyph[row] >> (GLYPH_WIDTH - 1 - offset) & 1;
+}
+}  // namespace
+
+void Label::Rasterize(const text_t& text) noexcept {
+  for (size_t row = 0; row < GLYPH_HEIGHT; ++row) {
+    auto& [lengths, count]{m_rows[row]};
+    size_t run_idx{0};
+    lengths[run_idx] = 0;
+    for (size_t column = 0; column < BAND_COLUMNS; ++column) {
+      // Even runs are paper, odd ones are ink
+      if (is_ink(text, row, column) != (run_idx % 2 == 1)) {
+        lengths[++run_idx] = 0;
+      }
+      ++lengths[run_idx];
+    }
+    count = static_cast<uint8_t>(run_idx + 1);
+  }
+}
+
+void Label::Render(size_t row_idx, row_t& row) const noexcept {
+  const size_t font_row{row_idx / SCALE};
+  if (font_row < PADDING || font_row >= PADDING + GLYPH_HEIGHT) {
+    fill(begin(row), end(row), PAPER);
+    return;
+  }
+  const auto& [lengths, count]{m_rows[font_row - PADDING]};
+  auto* out{data(row)};
+  for (size_t idx = 0; idx < count; ++idx) {
+    out = fill_n(out, lengths[idx] * SCALE, idx % 2 ? INK : PAPER);
+  }
+}
+
+const Label& LabelCache::Get(const char* text) noexcept {
+  text_t key{};
+  for (size_t idx = 0; idx < MAX_CHARS && text[idx]; ++idx) {
+    key[idx] = normalize(text[idx]);
+  }
+  if (const Label* cached = m_cache.Find(key); cached) {
+    return *cached;
+  }
+  auto& label{m_cache.Emplace(key)};
+  label.Rasterize(key);
+  return label;
+}
+}  // namespace osd
\ No newline at end of file
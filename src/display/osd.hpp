@@ -0,0 +1,72 @@
+#pragma once
+#include "color.hpp"
+#include "lcd.hpp"
+
+#include <filesystem/bmp.hpp>
+#include <storage/lru.hpp>
+#include <tools/singleton.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace osd {
+inline constexpr std::uint16_t GLYPH_WIDTH{5};
+inline constexpr std::uint16_t GLYPH_HEIGHT{7};
+inline constexpr std::uint16_t GLYPH_SPACING{1};
+inline constexpr std::uint16_t SCALE{2};
+// Blank font rows above and below the text
+inline constexpr std::uint16_t PADDING{1};
+
+inline constexpr std::uint16_t BAND_COLUMNS{lcd::Panel::PIXEL_HORIZONTAL /
+                                            SCALE};
+inline constexpr std::uint16_t BAND_HEIGHT{(GLYPH_HEIGHT + 2 * PADDING) *
+                                           SCALE};
+inline constexpr std::size_t MAX_CHARS{(BAND_COLUMNS - GLYPH_SPACING) /
+                                       (GLYPH_WIDTH + GLYPH_SPACING)};
+
+inline constexpr std::size_t LABEL_CACHE_CAPACITY{2};
+
+inline constexpr bmp::Rgb666 INK{
+    color::ToRgb666(bmp::Bgr888{0xFF, 0xFF, 0xFF})};
+inline constexpr bmp::Rgb666 PAPER{
+    color::ToRgb666(bmp::Bgr888{0x20, 0x20, 0x20})};
+
+using text_t = std::array<char, MAX_CHARS + 1>;
+using row_t = std::array<bmp::Rgb666, lcd::Panel::PIXEL_HORIZONTAL>;
+
+// A line of text rasterized once into alternating paper and ink runs per
+// font row (paper first), expanded into RGB666 rows when drawn
+class Label {
+  // Every column may start a run, plus the leading paper one
+  static constexpr std::size_t MAX_RUNS{BAND_COLUMNS + 1};
+
+  struct Runs {
+    std::array<std::uint8_t, MAX_RUNS> lengths;
+    std::uint8_t count;
+  };
+
+ public:
+  void Rasterize(const text_t& text) noexcept;
+
+  // Rows are counted from the top of the band, pixels from the left
+  void Render(std::size_t row_idx, row_t& row) const noexcept;
+
+ private:
+  std::array<Runs, GLYPH_HEIGHT> m_rows{};
+};
+
+class LabelCache : public pv::Singleton<LabelCache> {
+ public:
+  // Letters are upper-cased, the text beyond MAX_CHARS is cut off
+  [[nodiscard]] const Label& Get(const char* text) noexcept;
+
+ private:
+  friend Singleton;
+
+  LabelCache() = default;
+
+ private:
+  storage::LruCache<LABEL_CACHE_CAPACITY, text_t, Label> m_cache;
+};
+}  // namespace osd
\ No newline at end of file
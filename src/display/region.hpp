@@ -0,0 +1,112 @@
+#pragma once
+#include "lcd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace pv {
+// Inclusive bounds, as CASET/RASET take them
+struct Rect {
+  std::uint16_t x0;
+  std::uint16_t y0;
+  std::uint16_t x1;
+  std::uint16_t y1;
+
+  [[nodiscard]] constexpr std::size_t GetWidth() const noexcept {
+    return static_cast<std::size_t>(x1 - x0 + 1);
+  }
+
+  [[nodiscard]] constexpr std::size_t GetHeight() const noexcept {
+    return static_cast<std::size_t>(y1 - y0 + 1);
+  }
+
+  [[nodiscard]] constexpr std::size_t GetArea() const noexcept {
+    return GetWidth() * GetHeight();
+  }
+
+  static constexpr Rect Screen() noexcept {
+    return {0, 0, lcd::Panel::PIXEL_HORIZONTAL - 1,
+            lcd::Panel::PIXEL_VERTICAL - 1};
+  }
+};
+
+constexpr Rect Union(const Rect& lhs, const Rect& rhs) noexcept {
+  return {std::min(lhs.x0, rhs.x0), std::min(lhs.y0, rhs.y0),
+          std::max(lhs.x1, rhs.x1), std::max(lhs.y1, rhs.y1)};
+}
+
+constexpr bool Overlaps(const Rect& lhs, const Rect& rhs) noexcept {
+  return lhs.x0 <= rhs.x1 && rhs.x0 <= lhs.x1 && lhs.y0 <= rhs.y1 &&
+         rhs.y0 <= lhs.y1;
+}
+
+// Keeps up to Capacity disjoint rectangles. Overlapping ones are merged,
+// and if there is no room left, the new one is merged with the rectangle
+// that grows the least.
+template <std::size_t Capacity>
+class DirtyRegion {
+  static_assert(Capacity > 0, "region can't be empty");
+
+ public:
+  void Mark(Rect rect) noexcept {
+    for (;;) {
+      absorb_overlapping(rect);
+      if (m_count < Capacity) {
+        m_rects[m_count++] = rect;
+        return;
+      }
+      const std::size_t idx{find_cheapest_merge(rect)};
+      rect = Union(rect, m_rects[idx]);
+      m_rects[idx] = m_rects[--m_count];
+    }
+  }
+
+  void Reset() noexcept { m_count = 0; }
+
+  [[nodiscard]] bool IsEmpty() const noexcept { return m_count == 0; }
+
+  [[nodiscard]] std::size_t GetArea() const noexcept {
+    std::size_t area{0};
+    for (const auto& rect : *this) {
+      area += rect.GetArea();
+    }
+    return area;
+  }
+
+  const Rect* begin() const noexcept { return std::data(m_rects); }
+  const Rect* end() const noexcept { return std::data(m_rects) + m_count; }
+
+ private:
+  void absorb_overlapping(Rect& rect) noexcept {
+    for (std::size_t idx = 0; idx < m_count;) {
+      if (Overlaps(rect, m_rects[idx])) {
+        rect = Union(rect, m_rects[idx]);
+        m_rects[idx] = m_rects[--m_count];
+        idx = 0;  // The grown rectangle may overlap the checked ones
+      } else {
+        ++idx;
+      }
+    }
+  }
+
+  std::size_t find_cheapest_merge(const Rect& rect) const noexcept {
+    std::size_t best_idx{0};
+    std::size_t best_growth{SIZE_MAX};
+    for (std::size_t idx = 0; idx < m_count; ++idx) {
+      const std::size_t growth{Union(rect, m_rects[idx]).GetArea() -
+                               m_rects[idx].GetArea()};
+      if (growth < best_growth) {
+        best_idx = idx;
+        best_growth = growth;
+      }
+    }
+    return best_idx;
+  }
+
+ private:
+  std::array<Rect, Capacity> m_rects{};
+  std::size_t m_count{0};
+};
+}  // namespace pv
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "transition.hpp"
+#include "vsync.hpp"
+
+using namespace std;
+
+namespace pv {
+SlideTransition::SlideTransition(Display& display, uint16_t step) noexcept
+    : m_display{display}, m_step{clamp<uint16_t>(step, 1, MAX_STEP)} {}
+
+SlideTransition::~SlideTransition() noexcept {
+  m_display.Scroll(0);
+}
+
+bool SlideTransition::IsCompleted() const noexcept {
+  return m_scrolled == lcd::Panel::GRAM_LINES;
+}
+
+void SlideTransition::scroll() noexcept {
+  // Moving the start line in the blanking keeps the step from tearing
+  if (const auto& vsync = lcd::Vsync::GetInstance(); vsync.GetPeriod()) {
+    vsync.WaitForBlanking();
+  }
+  m_display.Scroll(m_scrolled % lcd::Panel::GRAM_LINES);
+}
+}  // namespace pv
\ No newline at end of file
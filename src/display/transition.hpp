@@ -0,0 +1,77 @@
+#pragma once
+#include "display.hpp"
+#include "lcd.hpp"
+
+#include <filesystem/bmp.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace pv {
+// Slides a new frame in with the hardware vertical scroll. GRAM has more
+// lines than the panel shows, so every step writes only the lines it is
+// about to reveal into the hidden band and then moves the scroll start
+// with a single command. The hidden lines behind the panel are revealed
+// first as a blank gap, then the frame rows follow in order, so the frame
+// ends up at its usual place with no scroll offset.
+class SlideTransition {
+ public:
+  enum class Status { Completed, InProgress, Failed };
+
+  using row_t = std::array<bmp::Rgb666, lcd::Panel::PIXEL_HORIZONTAL>;
+
+  static constexpr std::uint16_t MAX_STEP{lcd::Panel::GRAM_LINES -
+                                          lcd::Panel::PIXEL_VERTICAL};
+
+ public:
+  SlideTransition(Display& display, std::uint16_t step) noexcept;
+
+  SlideTransition(const SlideTransition&) = delete;
+  SlideTransition(SlideTransition&&) = delete;
+  SlideTransition& operator=(const SlideTransition&) = delete;
+  SlideTransition& operator=(SlideTransition&&) = delete;
+
+  // An interrupted transition leaves the frame rows at their places anyway
+  ~SlideTransition() noexcept;
+
+  [[nodiscard]] bool IsCompleted() const noexcept;
+
+  // RowSource is bool(row_t&), it's asked for the frame rows in order
+  template <class RowSource>
+  Status Step(RowSource&& source) noexcept {
+    if (IsCompleted()) {
+      return Status::Completed;
+    }
+    const auto count{static_cast<std::uint16_t>(
+        std::min<unsigned>(m_step, lcd::Panel::GRAM_LINES - m_scrolled))};
+    for (std::uint16_t idx = 0; idx < count; ++idx) {
+      const auto line{static_cast<std::uint16_t>(
+          (m_scrolled + lcd::Panel::PIXEL_VERTICAL + idx) %
+          lcd::Panel::GRAM_LINES)};
+      const Rect area{0, line, lcd::Panel::PIXEL_HORIZONTAL - 1, line};
+      if (line >= lcd::Panel::PIXEL_VERTICAL) {
+        m_display.Fill(area, bmp::Rgb666{});
+      } else if (source(m_row)) {
+        m_display.SetWindow(area);
+        m_display.DrawSpan(std::data(m_row), std::size(m_row));
+      } else {
+        return Status::Failed;
+      }
+    }
+    m_scrolled = static_cast<std::uint16_t>(m_scrolled + count);
+
+    scroll();
+    return IsCompleted() ? Status::Completed : Status::InProgress;
+  }
+
+ private:
+  void scroll() noexcept;
+
+ private:
+  Display& m_display;
+  std::uint16_t m_step;
+  std::uint16_t m_scrolled{0};
+  row_t m_row;
+};
+}  // namespace pv
\ No newline at end of file
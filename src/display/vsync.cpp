@@ -0,0 +1,98 @@
+#include "vsync.hpp"
+#include "lcd.hpp"
+
+#include <platform/event.hpp>
+#include <tools/attributes.hpp>
+
+using namespace std;
+
+namespace lcd {
+auto Vsync::GetCount() const noexcept -> count_t {
+  return m_count;
+}
+
+auto Vsync::GetFramesSince(count_t mark) const noexcept -> count_t {
+  return m_count - mark;
+}
+
+systick::microseconds_t Vsync::GetPeriod() const noexcept {
+  return m_period;
+}
+
+bool Vsync::WaitForBlanking() const noexcept {
+  const auto& clock{systick::Clock::GetInstance()};
+  const count_t mark{m_count};
+  const auto started_at{clock.Now()};
+  while (m_count == mark) {
+    if (clock.Now() - started_at >= BLANKING_TIMEOUT) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Vsync::Pace(uint16_t first_row,
+                 uint16_t last_row,
+                 systick::microseconds_t duration) const noexcept {
+  const systick::microseconds_t period{m_period};
+  if (!period) {
+    return;
+  }
+
+  // Rows are spread evenly over the whole period, porches are ignored
+  const systick::microseconds_t window_start{first_row * period /
+                                             Panel::PIXEL_VERTICAL};
+  const systick::microseconds_t window_end{(last_row + 1u) * period /
+                                           Panel::PIXEL_VERTICAL};
+  if (duration + (window_end - window_start) >= period) {
+    WaitForBlanking();
+    return;
+  }
+
+  const auto& clock{systick::Clock::GetInstance()};
+  for (;;) {
+    const systick::microseconds_t elapsed{clock.NowUs() - m_last_edge};
+    if (elapsed >= 2 * period) {
+      return;  // TE has stopped
+    }
+    const systick::microseconds_t phase{elapsed % period};
+    const bool is_scanned{phase >= window_start && phase < window_end};
+    const systick::microseconds_t next_scan{
+        phase < window_start ? window_start : window_start + period};
+    if (!is_scanned && phase + duration <= next_scan) {
+      return;
+    }
+  }
+}
+
+Vsync::Vsync() noexcept {
+  // V-blanking information only (M = 0)
+  Panel::GetInstance().SendCommand(Command::TearingEffectOn).Write(0x00);
+  setup_notifications();
+}
+
+void Vsync::setup_notifications() noexcept {
+  // LCD_TE is configured as input by Panel
+  auto& exti{event::ExtiManager::GetInstance().Get()};
+  SET_BIT(exti.IMR, EXTI_IMR_MR4);
+  SET_BIT(exti.RTSR, EXTI_RTSR_TR4);
+  SET_BIT(SYSCFG->EXTICR[1], SYSCFG_EXTICR2_EXTI4_PG);
+  NVIC_SetPriority(EXTI4_IRQn, INTERRUPT_PRIORITY);
+  NVIC_EnableIRQ(EXTI4_IRQn);
+}
+
+void OnTearingEffect() noexcept {
+  auto& vsync{Vsync::GetInstance()};
+  const auto now{systick::Clock::GetInstance().NowUs()};
+  if (vsync.m_count > 0) {
+    vsync.m_period = now - vsync.m_last_edge;
+  }
+  vsync.m_last_edge = now;
+  vsync.m_count = vsync.m_count + 1;
+}
+}  // namespace lcd
+
+EXTERN_C void EXTI4_IRQHandler() {
+  SET_BIT(EXTI->PR, EXTI_PR_PR4);
+  lcd::OnTearingEffect();
+}
\ No newline at end of file
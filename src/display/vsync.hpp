@@ -0,0 +1,48 @@
+#pragma once
+#include <platform/systick.hpp>
+#include <tools/singleton.hpp>
+
+#include <cstdint>
+
+namespace lcd {
+// Follows the panel scan with the tearing effect output (LCD_TE on PG4).
+// The panel raises TE when it enters the vertical blanking.
+class Vsync : public pv::Singleton<Vsync> {
+  static constexpr std::uint8_t INTERRUPT_PRIORITY{8};
+
+  // Give up waiting for TE if the line isn't connected
+  static constexpr systick::milliseconds_t BLANKING_TIMEOUT{50};
+
+ public:
+  using count_t = std::uint32_t;
+
+ public:
+  [[nodiscard]] count_t GetCount() const noexcept;
+  [[nodiscard]] count_t GetFramesSince(count_t mark) const noexcept;
+
+  // Zero until two TE edges are seen
+  [[nodiscard]] systick::microseconds_t GetPeriod() const noexcept;
+
+  bool WaitForBlanking() const noexcept;
+
+  // Delays a write of the rows [first_row, last_row] expected to last
+  // `duration` until the scan line can't cross it. If there is no such
+  // moment, the write is started at the blanking edge.
+  void Pace(std::uint16_t first_row,
+            std::uint16_t last_row,
+            systick::microseconds_t duration) const noexcept;
+
+ private:
+  friend void OnTearingEffect() noexcept;
+  friend Singleton;
+
+  Vsync() noexcept;
+
+  static void setup_notifications() noexcept;
+
+ private:
+  volatile count_t m_count{0};
+  volatile systick::microseconds_t m_last_edge{0};
+  volatile systick::microseconds_t m_period{0};
+};
+}  // namespace lcd
\ No newline at end of file
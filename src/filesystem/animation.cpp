@@ -0,0 +1,78 @@
+#include "animation.hpp"
+
+#include <tools/break_on.hpp>
+
+#include <utility>
+
+using namespace std;
+
+namespace anim {
+uint16_t FrameHeader::GetWidth() const noexcept {
+  return static_cast<uint16_t>(x1 - x0 + 1);
+}
+
+uint16_t FrameHeader::GetHeight() const noexcept {
+  return static_cast<uint16_t>(y1 - y0 + 1);
+}
+
+uint32_t FrameHeader::GetBitmapSize() const noexcept {
+  return static_cast<uint32_t>(GetWidth()) * GetHeight() * sizeof(bmp::Bgr888);
+}
+
+Animation::Animation(const ContainerHeader& header) noexcept
+    : m_header{header} {}
+
+optional<Animation> Animation::FromFile(fs::File& file) noexcept {
+  do {
+    ContainerHeader header;
+    BREAK_ON_FALSE(file.Read(reinterpret_cast<byte*>(addressof(header)),
+                             HEADER_RAW_SIZE) == HEADER_RAW_SIZE);
+    BREAK_ON_FALSE(header.signature == SIGNATURE);
+    BREAK_ON_FALSE(header.width && header.height);
+    BREAK_ON_FALSE(header.frames_count && header.frame_rate);
+
+    const Animation animation{header};
+    const auto first_frame{ReadFrameHeader(file)};
+    BREAK_ON_FALSE(first_frame && animation.IsKeyFrame(*first_frame));
+
+    BREAK_ON_FALSE(file.Seek(HEADER_RAW_SIZE));
+    return animation;
+
+  } while (false);
+
+  return nullopt;
+}
+
+optional<FrameHeader> Animation::ReadFrameHeader(fs::File& file) noexcept {
+  FrameHeader header;
+  if (file.Read(reinterpret_cast<byte*>(addressof(header)),
+                FRAME_HEADER_RAW_SIZE) != FRAME_HEADER_RAW_SIZE) {
+    return nullopt;
+  }
+  if (header.x1 < header.x0 || header.y1 < header.y0) {
+    return nullopt;
+  }
+  return header;
+}
+
+uint16_t Animation::GetWidth() const noexcept {
+  return m_header.width;
+}
+
+uint16_t Animation::GetHeight() const noexcept {
+  return m_header.height;
+}
+
+uint16_t Animation::GetFramesCount() const noexcept {
+  return m_header.frames_count;
+}
+
+uint16_t Animation::GetFrameRate() const noexcept {
+  return m_header.frame_rate;
+}
+
+bool Animation::IsKeyFrame(const FrameHeader& frame) const noexcept {
+  return frame.x0 == 0 && frame.y0 == 0 && frame.x1 == m_header.width - 1 &&
+         frame.y1 == m_header.height - 1;
+}
+}  // namespace anim
\ No newline at end of file
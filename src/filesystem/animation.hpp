@@ -0,0 +1,58 @@
+#pragma once
+#include "bmp.hpp"
+#include "file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace anim {
+// Container layout (little-endian):
+//   ContainerHeader, then frames_count times FrameHeader followed by
+//   (x1 - x0 + 1) * (y1 - y0 + 1) Bgr888 pixels in GRAM order.
+// The first frame must cover the whole screen; every next one carries only
+// the bounding box of the pixels changed since the previous frame
+struct ContainerHeader {
+  std::uint32_t signature;
+  std::uint16_t width;
+  std::uint16_t height;
+  std::uint16_t frames_count;
+  std::uint16_t frame_rate;
+};
+
+struct FrameHeader {
+  std::uint16_t x0;
+  std::uint16_t y0;
+  std::uint16_t x1;
+  std::uint16_t y1;
+
+  [[nodiscard]] std::uint16_t GetWidth() const noexcept;
+  [[nodiscard]] std::uint16_t GetHeight() const noexcept;
+  [[nodiscard]] std::uint32_t GetBitmapSize() const noexcept;
+};
+
+class Animation {
+  static constexpr std::uint32_t SIGNATURE{0x4E415650};  // "PVAN"
+
+ public:
+  static constexpr std::size_t HEADER_RAW_SIZE{sizeof(ContainerHeader)};
+  static constexpr std::size_t FRAME_HEADER_RAW_SIZE{sizeof(FrameHeader)};
+
+ public:
+  static std::optional<Animation> FromFile(fs::File& file) noexcept;
+  static std::optional<FrameHeader> ReadFrameHeader(fs::File& file) noexcept;
+
+  [[nodiscard]] std::uint16_t GetWidth() const noexcept;
+  [[nodiscard]] std::uint16_t GetHeight() const noexcept;
+  [[nodiscard]] std::uint16_t GetFramesCount() const noexcept;
+  [[nodiscard]] std::uint16_t GetFrameRate() const noexcept;
+
+  [[nodiscard]] bool IsKeyFrame(const FrameHeader& frame) const noexcept;
+
+ private:
+  Animation(const ContainerHeader& header) noexcept;
+
+ private:
+  ContainerHeader m_header;
+};
+}  // namespace anim
\ No newline at end of file
@@ -55,7 +55,11 @@ optional<Image> Image::FromFile(fs::File& file) noexcept {
   if (!bytes_read) {
     return nullopt;
   }
-  return FromStream(data(buffer), *bytes_read);
+  const auto image{FromStream(data(buffer), *bytes_read)};
+  if (!image || image->m_header.info.compression != Compression::BitFields) {
+    return image;
+  }
+  return check_color_masks(file) ? image : nullopt;
 }
 
 uint32_t Image::GetWidth() const noexcept {
@@ -70,6 +74,17 @@ uint32_t Image::GetBitmapOffset() const noexcept {
   return m_header.file.bitmap_offset;
 }
 
+PixelFormat Image::GetPixelFormat() const noexcept {
+  return m_header.info.bit_count == 16 ? PixelFormat::Rgb565
+                                       : PixelFormat::Bgr888;
+}
+
+size_t Image::GetRowSize() const noexcept {
+  // Rows are padded to 4 bytes
+  const size_t row_size{GetWidth() * m_header.info.bit_count / CHAR_BIT};
+  return (row_size + 3) & ~size_t{3};
+}
+
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
 #define LOAD_HEADER_FIELD(field, from, offset) \
   header.field =                               \
@@ -103,10 +118,27 @@ optional<InfoHeader> Image::load_info_header(const byte* from) noexcept {
     BREAK_ON_FALSE(header.width);
     BREAK_ON_FALSE(header.height);
 
+    // 24-bit BGR or 16-bit RGB565 described by bit fields
+    BREAK_ON_FALSE(
+        (header.bit_count == 24 && header.compression == Compression::Rgb) ||
+        (header.bit_count == 16 &&
+         header.compression == Compression::BitFields));
+
     return header;
 
   } while (false);
 
   return nullopt;
 }
+
+bool Image::check_color_masks(fs::File& file) noexcept {
+  array<byte, sizeof(ColorMasks)> buffer;
+  if (!file.Seek(COLOR_MASKS_OFFSET) ||
+      file.Read(data(buffer), size(buffer)) != size(buffer)) {
+    return false;
+  }
+  const auto masks{details::unaligned_load<ColorMasks>(data(buffer))};
+  return masks.red == RGB565_MASKS.red && masks.green == RGB565_MASKS.green &&
+         masks.blue == RGB565_MASKS.blue;
+}
 }  // namespace bmp
\ No newline at end of file
@@ -16,6 +16,21 @@ struct Rgb666 {
   std::uint16_t blue;
 };
 
+// R4..R0 in D15..D11, G5..G0 in D10..D5, B4..B0 in D4..D0
+struct Rgb565 {
+  std::uint16_t value;
+};
+
+enum class PixelFormat { Bgr888, Rgb565 };
+
+enum class Compression : std::uint32_t { Rgb = 0, BitFields = 3 };
+
+struct ColorMasks {
+  std::uint32_t red;
+  std::uint32_t green;
+  std::uint32_t blue;
+};
+
 struct FileHeader {
   std::uint16_t signature;
   std::uint32_t file_size;  // NOLINT(clang-diagnostic-padded)
@@ -29,6 +44,7 @@ struct InfoHeader {
   std::int32_t height;
   std::uint16_t planes;
   std::uint16_t bit_count;
+  Compression compression;
 };
 
 struct ImageHeader {
@@ -43,6 +59,10 @@ class Image {
                                                      INFO_HEADER_RAW_SIZE};
   static constexpr std::uint16_t SIGNATURE{0x4d42};
 
+  // Follow BITMAPINFOHEADER, V4 and V5 headers keep them at the same place
+  static constexpr std::size_t COLOR_MASKS_OFFSET{FILE_HEADER_RAW_SIZE + 40};
+  static constexpr ColorMasks RGB565_MASKS{0xF800, 0x07E0, 0x001F};
+
  public:
   static std::optional<Image> FromStream(const std::byte* stream,
                                          std::size_t size) noexcept;
@@ -51,6 +71,8 @@ class Image {
   [[nodiscard]] std::uint32_t GetWidth() const noexcept;
   [[nodiscard]] std::uint32_t GetHeight() const noexcept;
   [[nodiscard]] std::uint32_t GetBitmapOffset() const noexcept;
+  [[nodiscard]] PixelFormat GetPixelFormat() const noexcept;
+  [[nodiscard]] std::size_t GetRowSize() const noexcept;
 
  private:
   Image(const ImageHeader& header) noexcept;
@@ -61,6 +83,8 @@ class Image {
   static std::optional<InfoHeader> load_info_header(
       const std::byte* from) noexcept;
 
+  static bool check_color_masks(fs::File& file) noexcept;
+
  private:
   ImageHeader m_header;
 };
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+namespace gallery {
+using cache_key_t = std::uint32_t;
+
+// FNV-1a over the file name
+constexpr cache_key_t MakeCacheKey(const char* path) noexcept {
+  cache_key_t value{2166136261u};
+  while (*path) {
+    value ^= static_cast<std::uint8_t>(*path++);
+    value *= 16777619u;
+  }
+  return value;
+}
+}  // namespace gallery
\ No newline at end of file
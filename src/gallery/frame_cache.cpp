@@ -0,0 +1,149 @@
+#include "frame_cache.hpp"
+
+using namespace std;
+
+namespace gallery {
+void FrameCache::BeginRecord(cache_key_t key) noexcept {
+  if (m_recording) {
+    abort_record();
+  }
+  if (m_entries_count == FRAME_CACHE_CAPACITY) {
+    evict_oldest();
+  }
+  m_recording = true;
+  m_record = {key, m_write_pos, 0};
+  m_pending_count = 0;
+  m_literals_count = 0;
+}
+
+void FrameCache::Record(pixel_t pixel) noexcept {
+  if (!m_recording) {
+    return;
+  }
+  if (m_pending_count > 0 && m_pending_count < MAX_RUN &&
+      is_same(pixel, m_pending)) {
+    ++m_pending_count;
+  } else {
+    flush_pending();
+    m_pending = pixel;
+    m_pending_count = 1;
+  }
+}
+
+void FrameCache::EndRecord() noexcept {
+  if (!m_recording) {
+    return;
+  }
+  flush_pending();
+  close_literals();
+  if (m_recording) {
+    m_entries[(m_oldest + m_entries_count) % FRAME_CACHE_CAPACITY] = m_record;
+    ++m_entries_count;
+    ++m_statistics.stored;
+    m_recording = false;
+  }
+}
+
+auto FrameCache::GetStatistics() const noexcept -> const Statistics& {
+  return m_statistics;
+}
+
+auto FrameCache::find(cache_key_t key) const noexcept -> const Entry* {
+  for (size_t idx = m_entries_count; idx > 0; --idx) {
+    const auto& entry{m_entries[(m_oldest + idx - 1) % FRAME_CACHE_CAPACITY]};
+    if (entry.key == key) {
+      return addressof(entry);
+    }
+  }
+  return nullptr;
+}
+
+void FrameCache::flush_pending() noexcept {
+  if (m_pending_count >= MIN_RUN) {
+    close_literals();
+    const auto header{
+        static_cast<uint8_t>(RUN_FLAG + m_pending_count - MIN_RUN)};
+    if (put(addressof(header), sizeof(header))) {
+      put(addressof(m_pending), sizeof(pixel_t));
+    }
+  } else if (m_pending_count == 1) {
+    if (m_literals_count == 0) {
+      m_literals_header = m_write_pos;
+      const uint8_t placeholder{0};
+      put(addressof(placeholder), sizeof(placeholder));
+    }
+    put(addressof(m_pending), sizeof(pixel_t));
+    if (++m_literals_count == MAX_LITERALS) {
+      close_literals();
+    }
+  }
+  m_pending_count = 0;
+}
+
+void FrameCache::close_literals() noexcept {
+  if (m_literals_count > 0 && m_recording) {
+    m_arena[m_literals_header] = static_cast<uint8_t>(m_literals_count - 1);
+  }
+  m_literals_count = 0;
+}
+
+bool FrameCache::put(const void* value, size_t bytes_count) noexcept {
+  if (!m_recording) {
+    return false;
+  }
+  if (!reserve(bytes_count)) {
+    abort_record();
+    ++m_statistics.rejected;
+    return false;
+  }
+  const auto* bytes{static_cast<const uint8_t*>(value)};
+  for (size_t idx = 0; idx < bytes_count; ++idx) {
+    m_arena[m_write_pos] = bytes[idx];
+    m_write_pos = (m_write_pos + 1) % FRAME_CACHE_BUDGET;
+  }
+  m_bytes_used += bytes_count;
+  m_record.length += bytes_count;
+  return true;
+}
+
+bool FrameCache::reserve(size_t bytes_count) noexcept {
+  while (FRAME_CACHE_BUDGET - m_bytes_used < bytes_count) {
+    if (m_entries_count == 0) {
+      return false;
+    }
+    evict_oldest();
+  }
+  return true;
+}
+
+void FrameCache::evict_oldest() noexcept {
+  m_bytes_used -= m_entries[m_oldest].length;
+  m_oldest = (m_oldest + 1) % FRAME_CACHE_CAPACITY;
+  --m_entries_count;
+}
+
+void FrameCache::abort_record() noexcept {
+  // Entries are laid out back to back, so the tail is simply rolled back
+  m_bytes_used -= m_record.length;
+  m_write_pos = m_record.offset;
+  m_recording = false;
+}
+
+uint8_t FrameCache::load_byte(size_t position) const noexcept {
+  return m_arena[position % FRAME_CACHE_BUDGET];
+}
+
+auto FrameCache::load_pixel(size_t position) const noexcept -> pixel_t {
+  array<uint8_t, sizeof(pixel_t)> raw;
+  for (size_t idx = 0; idx < size(raw); ++idx) {
+    raw[idx] = load_byte(position + idx);
+  }
+  pixel_t pixel;
+  memcpy(addressof(pixel), data(raw), sizeof(pixel_t));
+  return pixel;
+}
+
+bool FrameCache::is_same(pixel_t lhs, pixel_t rhs) noexcept {
+  return lhs.red_green == rhs.red_green && lhs.blue == rhs.blue;
+}
+}  // namespace gallery
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+#include "cache_key.hpp"
+
+#include <filesystem/bmp.hpp>
+#include <tools/singleton.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace gallery {
+inline constexpr std::size_t FRAME_CACHE_CAPACITY{4};
+
+// Takes most of the SRAM left after the transmitter and the thumbnail
+inline constexpr std::size_t FRAME_CACHE_BUDGET{96 * 1024};
+
+// Replayed pixels are expanded into spans of up to a panel row
+inline constexpr std::size_t REPLAY_SPAN_CAPACITY{240};
+
+// Keeps the last displayed frames as they came from the peer, packed with
+// PackBits over RGB666 pixels: a header byte below 0x80 is followed by
+// (header + 1) literal pixels, otherwise a single pixel is repeated
+// (header - 0x80 + 2) times. Frames share a byte ring and are evicted
+// oldest first
+class FrameCache : public pv::Singleton<FrameCache> {
+  using pixel_t = bmp::Rgb666;
+
+  static constexpr std::uint8_t RUN_FLAG{0x80};
+  static constexpr std::size_t MAX_LITERALS{RUN_FLAG};
+  static constexpr std::size_t MIN_RUN{2};
+  static constexpr std::size_t MAX_RUN{RUN_FLAG + MIN_RUN - 1};
+
+  struct Entry {
+    cache_key_t key;
+    std::size_t offset;
+    std::size_t length;
+  };
+
+ public:
+  struct Statistics {
+    std::uint32_t lookups;
+    std::uint32_t hits;
+    std::uint32_t stored;
+    std::uint32_t rejected;
+  };
+
+ public:
+  // The handler takes (const pixel_t* pixels, std::size_t count), the span
+  // is reused once it returns
+  template <class SpanHandler>
+  bool Replay(cache_key_t key, SpanHandler handler) noexcept {
+    ++m_statistics.lookups;
+    const Entry* entry{find(key)};
+    if (!entry) {
+      return false;
+    }
+    ++m_statistics.hits;
+
+    std::array<pixel_t, REPLAY_SPAN_CAPACITY> span;
+    std::size_t span_size{0};
+    const auto emit{[&](pixel_t pixel, std::size_t count) {
+      while (count > 0) {
+        const std::size_t chunk{
+            std::min(count, REPLAY_SPAN_CAPACITY - span_size)};
+        std::fill_n(std::data(span) + span_size, chunk, pixel);
+        span_size += chunk;
+        count -= chunk;
+        if (span_size == REPLAY_SPAN_CAPACITY) {
+          std::invoke(handler, std::data(span), span_size);
+          span_size = 0;
+        }
+      }
+    }};
+
+    std::size_t position{entry->offset};
+    const std::size_t last{position + entry->length};
+    while (position < last) {
+      const auto header{load_byte(position++)};
+      if (header < RUN_FLAG) {
+        for (std::size_t idx = 0; idx <= header; ++idx) {
+          emit(load_pixel(position), 1);
+          position += sizeof(pixel_t);
+        }
+      } else {
+        emit(load_pixel(position), header - RUN_FLAG + MIN_RUN);
+        position += sizeof(pixel_t);
+      }
+    }
+    if (span_size > 0) {
+      std::invoke(handler, std::data(span), span_size);
+    }
+    return true;
+  }
+
+  void BeginRecord(cache_key_t key) noexcept;
+  void Record(pixel_t pixel) noexcept;
+  void EndRecord() noexcept;
+
+  [[nodiscard]] const Statistics& GetStatistics() const noexcept;
+
+ private:
+  friend Singleton;
+
+  FrameCache() = default;
+
+  const Entry* find(cache_key_t key) const noexcept;
+
+  void flush_pending() noexcept;
+  void close_literals() noexcept;
+  bool put(const void* value, std::size_t bytes_count) noexcept;
+  bool reserve(std::size_t bytes_count) noexcept;
+  void evict_oldest() noexcept;
+  void abort_record() noexcept;
+
+  std::uint8_t load_byte(std::size_t position) const noexcept;
+  pixel_t load_pixel(std::size_t position) const noexcept;
+
+  static bool is_same(pixel_t lhs, pixel_t rhs) noexcept;
+
+ private:
+  std::array<std::uint8_t, FRAME_CACHE_BUDGET> m_arena;
+  std::size_t m_write_pos{0};
+  std::size_t m_bytes_used{0};
+
+  std::array<Entry, FRAME_CACHE_CAPACITY> m_entries{};
+  std::size_t m_oldest{0};
+  std::size_t m_entries_count{0};
+
+  bool m_recording{false};
+  Entry m_record{};
+  pixel_t m_pending{};
+  std::size_t m_pending_count{0};
+  std::size_t m_literals_header{0};
+  std::size_t m_literals_count{0};
+
+  Statistics m_statistics{};
+};
+}  // namespace gallery
\ No newline at end of file
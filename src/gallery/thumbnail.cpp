@@ -0,0 +1,109 @@
+#include "thumbnail.hpp"
+
+#include <display/color.hpp>
+#include <tools/break_on.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace std;
+
+namespace gallery {
+Decimator::Decimator(Thumbnail& thumbnail) noexcept : m_thumbnail{thumbnail} {}
+
+void Decimator::Push(const source_row_t& row) noexcept {
+  for (size_t idx = 0; idx < size(row); ++idx) {
+    auto& sums{m_sums[idx / THUMBNAIL_SCALE]};
+    const auto& [blue, green, red]{row[idx]};
+    sums[0] += blue;
+    sums[1] += green;
+    sums[2] += red;
+  }
+  if (++m_rows_pushed % THUMBNAIL_SCALE == 0) {
+    flush_row();
+  }
+}
+
+bool Decimator::IsCompleted() const noexcept {
+  return m_rows_pushed == THUMBNAIL_SIDE * THUMBNAIL_SCALE;
+}
+
+void Decimator::flush_row() noexcept {
+  // Rows are mirrored to be drawn in the default orientation, as the
+  // sidecar ones
+  auto& row{m_thumbnail[m_rows_pushed / THUMBNAIL_SCALE - 1]};
+  for (size_t idx = 0; idx < THUMBNAIL_SIDE; ++idx) {
+    auto& sums{m_sums[idx]};
+    row[THUMBNAIL_SIDE - idx - 1] = {
+        static_cast<uint8_t>(sums[0] / BLOCK_SIZE),
+        static_cast<uint8_t>(sums[1] / BLOCK_SIZE),
+        static_cast<uint8_t>(sums[2] / BLOCK_SIZE)};
+    sums = {};
+  }
+}
+
+const Thumbnail* ThumbnailLoader::Load(const char* path,
+                                       fs::File& file,
+                                       const bmp::Image& image) noexcept {
+  if (!load_sidecar(path, m_thumbnail) &&
+      !decimate(file, image, m_thumbnail)) {
+    return nullptr;
+  }
+  return addressof(m_thumbnail);
+}
+
+bool ThumbnailLoader::load_sidecar(const char* path,
+                                   Thumbnail& thumbnail) noexcept {
+  array<char, FF_MAX_LFN + 1> sidecar_path{};
+
+  do {
+    const char* dot_pos{strrchr(path, '.')};
+    const size_t stem_length{dot_pos ? static_cast<size_t>(dot_pos - path)
+                                     : strlen(path)};
+    BREAK_ON_FALSE(stem_length + strlen(SIDECAR_EXTENSION) + 1 <
+                   size(sidecar_path));
+
+    memcpy(data(sidecar_path), path, stem_length);
+    sidecar_path[stem_length] = '.';
+    strcpy(data(sidecar_path) + stem_length + 1, SIDECAR_EXTENSION);
+
+    fs::File sidecar{data(sidecar_path), FA_READ | FA_OPEN_EXISTING};
+    BREAK_ON_FALSE(sidecar);
+
+    return sidecar.Read(reinterpret_cast<byte*>(data(thumbnail)),
+                        sizeof(Thumbnail)) == sizeof(Thumbnail);
+
+  } while (false);
+
+  return false;
+}
+
+bool ThumbnailLoader::decimate(fs::File& file,
+                               const bmp::Image& image,
+                               Thumbnail& thumbnail) noexcept {
+  Decimator decimator{thumbnail};
+  Decimator::source_row_t row;
+
+  if (!file.Seek(image.GetBitmapOffset())) {
+    return false;
+  }
+  const bool is_native{image.GetPixelFormat() == bmp::PixelFormat::Rgb565};
+  while (!decimator.IsCompleted()) {
+    if (is_native) {
+      array<bmp::Rgb565, lcd::Panel::PIXEL_HORIZONTAL> native_row;
+      if (file.Read(reinterpret_cast<byte*>(data(native_row)),
+                    sizeof(native_row)) != sizeof(native_row)) {
+        return false;
+      }
+      transform(begin(native_row), end(native_row), begin(row),
+                [](bmp::Rgb565 pixel) { return color::ToBgr888(pixel); });
+    } else if (file.Read(reinterpret_cast<byte*>(data(row)), sizeof(row)) !=
+               sizeof(row)) {
+      return false;
+    }
+    decimator.Push(row);
+  }
+  return true;
+}
+}  // namespace gallery
\ No newline at end of file
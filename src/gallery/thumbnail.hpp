@@ -0,0 +1,71 @@
+#pragma once
+#include <display/lcd.hpp>
+#include <filesystem/bmp.hpp>
+#include <filesystem/file.hpp>
+#include <tools/singleton.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace gallery {
+inline constexpr std::uint16_t THUMBNAIL_SCALE{3};
+inline constexpr std::uint16_t THUMBNAIL_SIDE{lcd::Panel::PIXEL_HORIZONTAL /
+                                              THUMBNAIL_SCALE};
+
+// Pre-rendered thumbnails are looked up as "<name>.thm" near the image
+inline constexpr auto* SIDECAR_EXTENSION{"thm"};
+
+using thumbnail_row_t = std::array<bmp::Bgr888, THUMBNAIL_SIDE>;
+using Thumbnail = std::array<thumbnail_row_t, THUMBNAIL_SIDE>;
+
+// Streaming box filter: averages THUMBNAIL_SCALE x THUMBNAIL_SCALE blocks
+// of source pixels being fed one row at a time, so only the partial sums of
+// a single thumbnail row are kept instead of the whole frame
+class Decimator {
+  static constexpr std::size_t CHANNELS_COUNT{sizeof(bmp::Bgr888)};
+  static constexpr std::uint16_t BLOCK_SIZE{THUMBNAIL_SCALE * THUMBNAIL_SCALE};
+
+ public:
+  using source_row_t = std::array<bmp::Bgr888, lcd::Panel::PIXEL_HORIZONTAL>;
+
+ public:
+  explicit Decimator(Thumbnail& thumbnail) noexcept;
+
+  void Push(const source_row_t& row) noexcept;
+  [[nodiscard]] bool IsCompleted() const noexcept;
+
+ private:
+  void flush_row() noexcept;
+
+ private:
+  Thumbnail& m_thumbnail;
+  std::array<std::array<std::uint16_t, CHANNELS_COUNT>, THUMBNAIL_SIDE>
+      m_sums{};
+  std::size_t m_rows_pushed{0};
+};
+
+// Holds the thumbnail of a single image. Pages are only turned forward, so
+// with more images than a page holds, recent thumbnails would never be
+// asked for again before being evicted; sidecars make a reload cheap.
+class ThumbnailLoader : public pv::Singleton<ThumbnailLoader> {
+ public:
+  // Overwrites the previous thumbnail
+  [[nodiscard]] const Thumbnail* Load(const char* path,
+                                      fs::File& file,
+                                      const bmp::Image& image) noexcept;
+
+ private:
+  friend Singleton;
+
+  ThumbnailLoader() = default;
+
+  static bool load_sidecar(const char* path, Thumbnail& thumbnail) noexcept;
+  static bool decimate(fs::File& file,
+                       const bmp::Image& image,
+                       Thumbnail& thumbnail) noexcept;
+
+ private:
+  Thumbnail m_thumbnail;
+};
+}  // namespace gallery
\ No newline at end of file
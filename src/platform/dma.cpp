@@ -0,0 +1,84 @@
+#include "dma.hpp"
+
+#include <tools/attributes.hpp>
+
+#include <cassert>
+
+using namespace std;
+
+namespace dma {
+namespace {
+constexpr uint32_t STREAM_FLAGS{DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 |
+                                DMA_LIFCR_CTEIF0 | DMA_LIFCR_CDMEIF0 |
+                                DMA_LIFCR_CFEIF0};
+
+template <class Ty>
+uint32_t to_address(Ty* ptr) noexcept {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr));
+}
+}  // namespace
+
+void MemoryStream::Start(const uint16_t* source,
+                         volatile uint16_t* destination,
+                         size_t count,
+                         completion_t callback,
+                         void* context) noexcept {
+  assert(count > 0 && count <= MAX_TRANSFER_LENGTH && "invalid length");
+  Wait();
+
+  m_callback = callback;
+  m_context = context;
+  m_busy = true;
+
+  // In memory-to-memory mode the peripheral port is the source
+  WRITE_REG(DMA2->LIFCR, STREAM_FLAGS);
+  WRITE_REG(m_stream->PAR, to_address(source));
+  WRITE_REG(m_stream->M0AR, to_address(destination));
+  WRITE_REG(m_stream->NDTR, static_cast<uint32_t>(count));
+  SET_BIT(m_stream->CR, DMA_SxCR_EN);
+}
+
+bool MemoryStream::IsBusy() const noexcept {
+  return m_busy;
+}
+
+void MemoryStream::Wait() const noexcept {
+  while (m_busy) {
+  }
+}
+
+MemoryStream::MemoryStream() noexcept : m_stream{DMA2_Stream0} {
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA2EN);
+
+  CLEAR_BIT(m_stream->CR, DMA_SxCR_EN);
+  while (READ_BIT(m_stream->CR, DMA_SxCR_EN)) {
+  }
+
+  // Channel 0, half-words on both sides, the direct mode isn't available
+  // for memory-to-memory transfers
+  WRITE_REG(m_stream->CR, DMA_SxCR_DIR_1 | DMA_SxCR_PINC | DMA_SxCR_PSIZE_0 |
+                              DMA_SxCR_MSIZE_0 | DMA_SxCR_PL_1 |
+                              DMA_SxCR_TCIE | DMA_SxCR_TEIE);
+  WRITE_REG(m_stream->FCR, DMA_SxFCR_DMDIS | DMA_SxFCR_FTH);
+
+  NVIC_SetPriority(DMA2_Stream0_IRQn, INTERRUPT_PRIORITY);
+  NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+}
+
+void OnTransferComplete(bool success) noexcept {
+  auto& stream{MemoryStream::GetInstance()};
+  const auto callback{stream.m_callback};
+  stream.m_busy = false;
+  if (callback) {
+    callback(stream.m_context, success);
+  }
+}
+}  // namespace dma
+
+EXTERN_C void DMA2_Stream0_IRQHandler() {
+  const uint32_t status{DMA2->LISR};
+  if (READ_BIT(status, DMA_LISR_TEIF0 | DMA_LISR_TCIF0)) {
+    WRITE_REG(DMA2->LIFCR, DMA_LIFCR_CTCIF0 | DMA_LIFCR_CTEIF0);
+    dma::OnTransferComplete(!READ_BIT(status, DMA_LISR_TEIF0));
+  }
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include <tools/singleton.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <stm32f4xx.h>
+
+namespace dma {
+using completion_t = void (*)(void* context, bool success);
+
+// DMA2 stream 0 in memory-to-memory mode. The source is incremented, the
+// destination is fixed, so it can feed a memory-mapped data port.
+class MemoryStream : public pv::Singleton<MemoryStream> {
+  static constexpr std::uint8_t INTERRUPT_PRIORITY{6};
+
+ public:
+  static constexpr std::size_t MAX_TRANSFER_LENGTH{0xFFFF};
+
+ public:
+  // Waits for the previous transfer, the source must stay alive until the
+  // completion callback
+  void Start(const std::uint16_t* source,
+             volatile std::uint16_t* destination,
+             std::size_t count,
+             completion_t callback = nullptr,
+             void* context = nullptr) noexcept;
+
+  [[nodiscard]] bool IsBusy() const noexcept;
+  void Wait() const noexcept;
+
+ private:
+  friend void OnTransferComplete(bool success) noexcept;
+  friend Singleton;
+
+  MemoryStream() noexcept;
+
+ private:
+  DMA_Stream_TypeDef* m_stream;
+  volatile bool m_busy{false};
+  completion_t m_callback{nullptr};
+  void* m_context{nullptr};
+};
+}  // namespace dma
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "systick.hpp"
+
+#include <tools/attributes.hpp>
+
+namespace systick {
+milliseconds_t Clock::Now() const noexcept {
+  return m_ticks;
+}
+
+microseconds_t Clock::NowUs() const noexcept {
+  milliseconds_t ticks;
+  uint32_t counter;
+  do {
+    ticks = m_ticks;
+    counter = SysTick->VAL;
+  } while (ticks != m_ticks);
+
+  const uint32_t reload{SysTick->LOAD};
+  return ticks * 1000 + (reload - counter) * 1000 / (reload + 1);
+}
+
+Clock::Clock() noexcept {
+  SysTick_Config(SystemCoreClock / TICK_FREQUENCY);
+  NVIC_SetPriority(SysTick_IRQn, INTERRUPT_PRIORITY);
+}
+
+void OnTick() noexcept {
+  auto& clock{Clock::GetInstance()};
+  clock.m_ticks = clock.m_ticks + 1;
+}
+}  // namespace systick
+
+EXTERN_C void SysTick_Handler() {
+  systick::OnTick();
+}
\ No newline at end of file
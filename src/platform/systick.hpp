@@ -0,0 +1,31 @@
+#pragma once
+#include <tools/singleton.hpp>
+
+#include <cstdint>
+
+#include <stm32f4xx.h>
+
+namespace systick {
+using milliseconds_t = std::uint32_t;
+using microseconds_t = std::uint32_t;
+
+class Clock : public pv::Singleton<Clock> {
+  static constexpr std::uint32_t TICK_FREQUENCY{1000};
+  static constexpr std::uint8_t INTERRUPT_PRIORITY{10};
+
+ public:
+  [[nodiscard]] milliseconds_t Now() const noexcept;
+
+  // Interpolated with the SysTick counter, wraps every ~71 minutes
+  [[nodiscard]] microseconds_t NowUs() const noexcept;
+
+ private:
+  friend void OnTick() noexcept;
+  friend Singleton;
+
+  Clock() noexcept;
+
+ private:
+  volatile milliseconds_t m_ticks{0};
+};
+}  // namespace systick
\ No newline at end of file
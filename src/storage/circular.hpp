@@ -48,6 +48,11 @@ class CircularBuffer {
     });
   }
 
+  [[nodiscard]] std::size_t size() const noexcept {
+    const std::size_t head = m_head, tail = m_tail;
+    return head <= tail ? tail - head : Capacity - head + tail;
+  }
+
  private:
   template <class InputIt>
   std::size_t produce_impl(InputIt in, std::size_t count) noexcept {
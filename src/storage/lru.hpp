@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace storage {
+template <std::size_t Capacity, class Key, class Ty>
+class LruCache {
+  static_assert(Capacity > 0, "cache can't be empty");
+  static_assert(std::is_default_constructible_v<Ty>,
+                "Ty must be default-constructible");
+
+  using stamp_t = std::uint32_t;
+
+  struct Slot {
+    Key key{};
+    stamp_t stamp{0};  // 0 - slot is free
+    Ty value{};
+  };
+
+ public:
+  Ty* Find(const Key& key) noexcept {
+    Slot* slot{find_slot(key)};
+    if (!slot) {
+      return nullptr;
+    }
+    slot->stamp = next_stamp();
+    return std::addressof(slot->value);
+  }
+
+  // Returns a slot for the key, evicting the least recently used entry
+  Ty& Emplace(const Key& key) noexcept {
+    Slot* slot{find_slot(key)};
+    if (!slot) {
+      slot = std::addressof(m_slots[0]);
+      for (auto& candidate : m_slots) {
+        if (candidate.stamp < slot->stamp) {
+          slot = std::addressof(candidate);
+        }
+      }
+      slot->key = key;
+    }
+    slot->stamp = next_stamp();
+    return slot->value;
+  }
+
+  void Erase(const Key& key) noexcept {
+    if (Slot* slot = find_slot(key); slot) {
+      slot->stamp = 0;
+    }
+  }
+
+  static constexpr std::size_t GetCapacity() noexcept { return Capacity; }
+
+ private:
+  Slot* find_slot(const Key& key) noexcept {
+    for (auto& slot : m_slots) {
+      if (slot.stamp != 0 && slot.key == key) {
+        return std::addressof(slot);
+      }
+    }
+    return nullptr;
+  }
+
+  stamp_t next_stamp() noexcept {
+    if (m_stamp == std::numeric_limits<stamp_t>::max()) {
+      renumber();
+    }
+    return ++m_stamp;
+  }
+
+  void renumber() noexcept {
+    // Keeps relative order of the occupied slots
+    m_stamp = 0;
+    for (std::size_t pass = 0; pass < Capacity; ++pass) {
+      Slot* oldest{nullptr};
+      for (auto& slot : m_slots) {
+        if (slot.stamp > m_stamp && (!oldest || slot.stamp < oldest->stamp)) {
+          oldest = std::addressof(slot);
+        }
+      }
+      if (!oldest) {
+        break;
+      }
+      oldest->stamp = ++m_stamp;
+    }
+  }
+
+ private:
+  std::array<Slot, Capacity> m_slots;
+  stamp_t m_stamp{0};
+};
+}  // namespace storage
\ No newline at end of file
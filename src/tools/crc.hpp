@@ -0,0 +1,40 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace crc {
+// CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF, no
+// reflection, driven by a table built at compile time
+inline constexpr std::uint16_t CRC16_INIT{0xFFFF};
+
+namespace details {
+inline constexpr std::uint16_t CRC16_POLYNOMIAL{0x1021};
+
+constexpr auto make_crc16_table() noexcept {
+  std::array<std::uint16_t, 256> table{};
+  for (std::size_t idx = 0; idx < std::size(table); ++idx) {
+    auto value{static_cast<std::uint16_t>(idx << 8)};
+    for (int bit = 0; bit < 8; ++bit) {
+      value = static_cast<std::uint16_t>(
+          value & 0x8000 ? value << 1 ^ CRC16_POLYNOMIAL : value << 1);
+    }
+    table[idx] = value;
+  }
+  return table;
+}
+
+inline constexpr auto CRC16_TABLE{make_crc16_table()};
+}  // namespace details
+
+constexpr std::uint16_t Update16(std::uint16_t crc,
+                                 const std::byte* data,
+                                 std::size_t count) noexcept {
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    const auto value{static_cast<std::uint8_t>(data[idx])};
+    crc = static_cast<std::uint16_t>(
+        crc << 8 ^ details::CRC16_TABLE[(crc >> 8 ^ value) & 0xFF]);
+  }
+  return crc;
+}
+}  // namespace crc
\ No newline at end of file
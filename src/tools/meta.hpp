@@ -32,4 +32,12 @@ struct TypeByIndex<Idx, TypeList<Types...>> {
 
 template <class... Types>
 inline constexpr bool always_false_v = false;
+
+template <class... Handlers>
+struct Overloaded : Handlers... {
+  using Handlers::operator()...;
+};
+
+template <class... Handlers>
+Overloaded(Handlers...) -> Overloaded<Handlers...>;
 }  // namespace meta
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <storage/circular.hpp>
 #include <tools/singleton.hpp>
 
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 
@@ -21,9 +23,40 @@ struct Command : io::Serializable<Command> {
     BlueLedOn = 0x4,
     BlueLedOff = 0x8,
     BlueLedToggle = BlueLedOn | BlueLedOff,
-    NextPicture = 0x80
+    Overlay = 0x10,
+    LocalRendering = 0x20,
+    ThumbnailGrid = 0x40,
+    NextPicture = 0x80,
+    // Every bit above is taken, so the link codes below combine them. The
+    // peer must match commands exactly: one testing single bits would take
+    // them for NextPicture and the rest. Peers that don't know a code
+    // ignore it, which declines the request.
+    // The low bits carry the index of the rate in io::Receiver::SPEEDS
+    LinkSpeed = 0xF0,
+    LinkSpeedConfirm = 0xE0,
+    BurstMode = 0xD0,
+    BurstModeConfirm = 0xC0,
+    // Echoed by peers that accept v2 data blocks
+    ProtocolV2 = 0xB0,
+    // Echoed by peers that decode rows packed by io::RowCodec
+    RowCodec = 0xA0
   };
 
+  static constexpr std::uint8_t LINK_SPEED_MASK{0x0F};
+
+  // Link codes the peer sends back answer a request of this board, they
+  // aren't commands for the viewer
+  [[nodiscard]] bool IsLinkReply() const noexcept {
+    return static_cast<std::uint8_t>(type) >=
+           static_cast<std::uint8_t>(Type::RowCodec);
+  }
+
+  [[nodiscard]] static Command MakeLinkSpeed(std::size_t speed_idx) noexcept {
+    assert(speed_idx <= LINK_SPEED_MASK && "speed index is too large");
+    const auto base{static_cast<std::size_t>(Type::LinkSpeed)};
+    return Command{static_cast<Type>(base | speed_idx)};
+  }
+
   [[nodiscard]] std::uint8_t Serialize() const noexcept {
     return static_cast<std::uint8_t>(type);
   }
@@ -48,6 +81,9 @@ constexpr bool operator==(Command lhs, Command rhs) {
 }
 
 struct NextPictureTag {};
+struct ThumbnailGridTag {};
+struct LocalRenderingTag {};
+struct OverlayTag {};
 
 namespace details {
 class Joystick {
@@ -76,6 +112,12 @@ class CommandManager : public pv::Singleton<CommandManager> {
   void Execute(Command command, Handler&& handler) {
     if (command == Command::Type::NextPicture) {
       std::invoke(std::forward<Handler>(handler), NextPictureTag{});
+    } else if (command == Command::Type::ThumbnailGrid) {
+      std::invoke(std::forward<Handler>(handler), ThumbnailGridTag{});
+    } else if (command == Command::Type::LocalRendering) {
+      std::invoke(std::forward<Handler>(handler), LocalRenderingTag{});
+    } else if (command == Command::Type::Overlay) {
+      std::invoke(std::forward<Handler>(handler), OverlayTag{});
     }
   }
 
@@ -1,7 +1,11 @@
 #pragma once
 #include <tools/break_on.hpp>
+#include <tools/crc.hpp>
 
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 
 namespace io {
@@ -19,7 +23,12 @@ struct Serializable {
 };
 
 struct BlockHeader : Serializable<BlockHeader> {
-  enum class Category : std::uint8_t { Data = 0x1, Command = 0x2 };
+  // Extended headers (protocol v2) are parsed by ExtendedHeader
+  enum class Category : std::uint8_t {
+    Data = 0x1,
+    Command = 0x2,
+    Extended = 0x3
+  };
   static constexpr std::size_t MAX_LENGTH{64};
 
   BlockHeader(Category cat, std::size_t sz) noexcept : category{cat}, size{sz} {
@@ -55,4 +64,103 @@ struct BlockHeader : Serializable<BlockHeader> {
   Category category;
   std::size_t size;
 };
+
+// Protocol v2 header, the first byte carries the Extended category:
+//   [0]    0b11, kind (2 bits), coded flag, length bits 10..8
+//   [1]    length bits 7..0
+//   [2..3] sequence id, little-endian
+//   [4..5] CRC-16 of bytes 0..3, little-endian
+//   [6..7] CRC-16 of the payload, little-endian
+// The header is checked on its own, so a damaged length can't misframe the
+// blocks that follow.
+// Control blocks name the data block they are about by its sequence id: the
+// peer sends a NAK for a block to be sent again, this side a skip for a
+// block that is past its NAK window. Coded data blocks carry a row packed by
+// io::RowCodec.
+struct ExtendedHeader : Serializable<ExtendedHeader> {
+  enum class Kind : std::uint8_t { Data = 0x1, Command = 0x2, Control = 0x3 };
+  enum class Control : std::uint8_t { Nak = 0x1, Skip = 0x2 };
+
+  static constexpr std::size_t SIZE{8};
+  static constexpr std::size_t CHECKED_SIZE{4};  // covered by the header CRC
+  static constexpr std::size_t MAX_LENGTH{1024};
+  // Control blocks carry the control code alone
+  static constexpr std::size_t CONTROL_LENGTH{1};
+
+  ExtendedHeader(Kind k,
+                 std::size_t sz,
+                 std::uint16_t seq,
+                 bool is_coded = false) noexcept
+      : kind{k}, size{sz}, sequence{seq}, coded{is_coded} {
+    assert(size != 0 && "invalid block header");
+    assert(size <= MAX_LENGTH && "block is too large");
+  }
+
+  [[nodiscard]] static constexpr bool IsExtended(std::byte value) noexcept {
+    return static_cast<std::uint8_t>(value) >> 6 ==
+           static_cast<std::uint8_t>(BlockHeader::Category::Extended);
+  }
+
+  // The payload CRC is calculated here
+  [[nodiscard]] std::array<std::byte, SIZE> Serialize(
+      const std::byte* payload) const noexcept {
+    std::array<std::byte, SIZE> raw{
+        static_cast<std::byte>(
+            static_cast<std::uint8_t>(BlockHeader::Category::Extended) << 6 |
+            static_cast<std::uint8_t>(kind) << 4 | coded << 3 | size >> 8),
+        static_cast<std::byte>(size & 0xFF),
+        static_cast<std::byte>(sequence & 0xFF),
+        static_cast<std::byte>(sequence >> 8)};
+    write_word(std::data(raw) + 4,
+               crc::Update16(crc::CRC16_INIT, std::data(raw), CHECKED_SIZE));
+    write_word(std::data(raw) + 6,
+               crc::Update16(crc::CRC16_INIT, payload, size));
+    return raw;
+  }
+
+  [[nodiscard]] static std::optional<ExtendedHeader> Deserialize(
+      const std::byte* raw_data,
+      std::size_t bytes_count) noexcept {
+    do {
+      BREAK_ON_FALSE(bytes_count >= SIZE && IsExtended(*raw_data));
+      BREAK_ON_FALSE(crc::Update16(crc::CRC16_INIT, raw_data, CHECKED_SIZE) ==
+                     read_word(raw_data + 4));
+
+      const auto first{static_cast<std::uint8_t>(raw_data[0])};
+      const auto block_size{static_cast<std::size_t>(
+          (first & 0x07) << 8 | static_cast<std::uint8_t>(raw_data[1]))};
+      BREAK_ON_FALSE(block_size != 0 && block_size <= MAX_LENGTH);
+
+      const auto kind{static_cast<Kind>(first >> 4 & 0x3)};
+      BREAK_ON_FALSE(kind == Kind::Data || kind == Kind::Command ||
+                     kind == Kind::Control);
+
+      ExtendedHeader header{kind, block_size, read_word(raw_data + 2),
+                            (first & 0x08) != 0};
+      header.crc = read_word(raw_data + 6);
+      return header;
+
+    } while (false);
+
+    return std::nullopt;
+  }
+
+  Kind kind;
+  std::size_t size;
+  std::uint16_t sequence;
+  bool coded;
+  std::uint16_t crc{0};  // of the payload, as received
+
+ private:
+  static std::uint16_t read_word(const std::byte* raw_data) noexcept {
+    return static_cast<std::uint16_t>(
+        static_cast<std::uint8_t>(raw_data[0]) |
+        static_cast<std::uint8_t>(raw_data[1]) << 8);
+  }
+
+  static void write_word(std::byte* raw_data, std::uint16_t value) noexcept {
+    raw_data[0] = static_cast<std::byte>(value & 0xFF);
+    raw_data[1] = static_cast<std::byte>(value >> 8);
+  }
+};
 }  // namespace io
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "negotiation.hpp"
+
+using namespace std;
+
+namespace io {
+LinkNegotiator::LinkNegotiator(Receiver& receiver,
+                               systick::milliseconds_t timeout) noexcept
+    : PatternNegotiator{timeout}, m_receiver{receiver} {}
+
+bool LinkNegotiator::start(Transmitter& transmitter) noexcept {
+  m_fallback = m_receiver.GetSpeed();
+  m_candidate = m_fallback + 1;
+  if (m_candidate == size(Receiver::SPEEDS)) {
+    return false;
+  }
+  transmitter.SendCommand(cmd::Command::MakeLinkSpeed(m_candidate));
+  return true;
+}
+
+bool LinkNegotiator::apply(Transmitter& transmitter) noexcept {
+  if (!transmitter.IsIdle()) {
+    return false;
+  }
+  m_receiver.SetSpeed(m_candidate);
+  transmitter.SetReturnLatency(Receiver::GetNakLatency(m_candidate));
+  m_line_errors = m_receiver.GetLineErrors();
+  return true;
+}
+
+bool LinkNegotiator::is_broken(const Transmitter&) const noexcept {
+  return m_receiver.GetLineErrors() != m_line_errors;
+}
+
+bool LinkNegotiator::confirm(Transmitter& transmitter) noexcept {
+  const cmd::Command confirmation{cmd::Command::Type::LinkSpeedConfirm};
+  transmitter.SendCommand(confirmation);
+  return true;
+}
+
+void LinkNegotiator::roll_back(Transmitter& transmitter) noexcept {
+  m_receiver.SetSpeed(m_fallback);
+  transmitter.SetReturnLatency(Receiver::GetNakLatency(m_fallback));
+}
+
+BurstNegotiator::BurstNegotiator(systick::milliseconds_t timeout) noexcept
+    : PatternNegotiator{timeout} {}
+
+void BurstNegotiator::Accept() noexcept {
+  m_accepted = true;
+}
+
+bool BurstNegotiator::start(Transmitter& transmitter) noexcept {
+  const cmd::Command request{cmd::Command::Type::BurstMode};
+  transmitter.SendCommand(request);
+  m_accepted = false;
+  return true;
+}
+
+bool BurstNegotiator::apply(Transmitter& transmitter) noexcept {
+  const auto& pattern{Receiver::TEST_PATTERN};
+  // The pattern is static, so its ticket isn't needed
+  return m_accepted && transmitter.SetMode(Transmitter::Mode::Burst) &&
+         transmitter.SendData(reinterpret_cast<const byte*>(data(pattern)),
+                              size(pattern));
+}
+
+bool BurstNegotiator::is_broken(const Transmitter& transmitter) const noexcept {
+  // An overwrite has already returned the port to the handshake mode
+  return transmitter.GetMode() != Transmitter::Mode::Burst;
+}
+
+bool BurstNegotiator::confirm(Transmitter& transmitter) noexcept {
+  const cmd::Command confirmation{cmd::Command::Type::BurstModeConfirm};
+  transmitter.SendCommand(confirmation);
+  return false;
+}
+
+void BurstNegotiator::roll_back(Transmitter& transmitter) noexcept {
+  // Leaving the burst mode always succeeds
+  static_cast<void>(transmitter.SetMode(Transmitter::Mode::Handshake));
+}
+
+LinkSetup::LinkSetup(Receiver& receiver, const Settings& settings) noexcept
+    : m_row_codec{settings.row_codec},
+      m_protocol_requested{!settings.protocol_v2} {
+  if (settings.link_speed) {
+    m_link.emplace(receiver, settings.test_timeout);
+  }
+  if (settings.burst) {
+    m_burst.emplace(settings.test_timeout);
+  }
+}
+
+void LinkSetup::OnReply(Transmitter& transmitter,
+                        const cmd::Command& reply) noexcept {
+  if (reply == cmd::Command::Type::BurstMode) {
+    if (m_burst.has_value()) {
+      m_burst->Accept();
+    }
+  } else if (reply == cmd::Command::Type::ProtocolV2) {
+    transmitter.SetProtocol(Transmitter::Protocol::V2);
+  } else if (reply == cmd::Command::Type::RowCodec) {
+    transmitter.SetRowCodec(true);
+  }
+}
+
+void LinkSetup::request_protocol(Transmitter& transmitter) noexcept {
+  const cmd::Command request{cmd::Command::Type::ProtocolV2};
+  transmitter.SendCommand(request);
+  if (m_row_codec) {
+    const cmd::Command codec_request{cmd::Command::Type::RowCodec};
+    transmitter.SendCommand(codec_request);
+  }
+  m_protocol_requested = true;
+}
+}  // namespace io
@@ -0,0 +1,205 @@
+#pragma once
+#include "command.hpp"
+#include "receiver.hpp"
+#include "transmitter.hpp"
+
+#include <platform/systick.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+
+namespace io {
+// Both negotiations send a request through the parallel port, apply the
+// change once the peer is ready for it and wait for the peer to deliver the
+// test pattern through the USART. An intact pattern is confirmed, anything
+// else rolls the change back and the peer does the same without the
+// confirmation. Each step may take up to the test timeout. Derived classes
+// provide the steps:
+//   bool start(Transmitter&)      sends the request, false if there is
+//                                 nothing to negotiate
+//   bool apply(Transmitter&)      true once the test is under way
+//   bool is_broken(const Transmitter&) const
+//   bool confirm(Transmitter&)    true to negotiate once more
+//   void roll_back(Transmitter&)
+template <class Derived>
+class PatternNegotiator {
+  enum class State { Idle, Requested, Verifying, Failed, Completed };
+
+ public:
+  enum class Status { Completed, InProgress };
+
+ public:
+  explicit PatternNegotiator(systick::milliseconds_t timeout) noexcept
+      : m_timeout{timeout} {}
+
+  // Takes the whole data queue, nothing else may be received meanwhile
+  template <class DataQueue>
+  Status Update(Transmitter& transmitter, DataQueue& queue) noexcept {
+    while (m_state == State::Verifying) {
+      const auto value{queue.consume()};
+      if (!value) {
+        break;
+      }
+      verify(*value);
+    }
+    return update(transmitter);
+  }
+
+ private:
+  Status update(Transmitter& transmitter) noexcept {
+    auto& self{static_cast<Derived&>(*this)};
+    switch (m_state) {
+      case State::Idle:
+        m_state = self.start(transmitter) ? State::Requested : State::Completed;
+        m_started_at = systick::Clock::GetInstance().Now();
+        break;
+      case State::Requested:
+        if (self.apply(transmitter)) {
+          m_matched = 0;
+          m_started_at = systick::Clock::GetInstance().Now();
+          m_state = State::Verifying;
+        } else if (is_expired()) {
+          m_state = State::Failed;
+        }
+        break;
+      case State::Verifying:
+        if (self.is_broken(transmitter) || is_expired()) {
+          m_state = State::Failed;
+        } else if (m_matched == std::size(Receiver::TEST_PATTERN)) {
+          m_state = self.confirm(transmitter) ? State::Idle : State::Completed;
+        }
+        break;
+      case State::Failed:
+        self.roll_back(transmitter);
+        m_state = State::Completed;
+        break;
+      case State::Completed:
+        break;
+    }
+    return m_state == State::Completed ? Status::Completed
+                                       : Status::InProgress;
+  }
+
+  void verify(std::byte value) noexcept {
+    const auto& pattern{Receiver::TEST_PATTERN};
+    if (m_matched == std::size(pattern) ||
+        static_cast<std::uint8_t>(value) != pattern[m_matched]) {
+      m_state = State::Failed;
+    } else {
+      ++m_matched;
+    }
+  }
+
+  [[nodiscard]] bool is_expired() const noexcept {
+    return systick::Clock::GetInstance().Now() - m_started_at >= m_timeout;
+  }
+
+ private:
+  systick::milliseconds_t m_timeout;
+  State m_state{State::Idle};
+  std::size_t m_matched{0};
+  systick::milliseconds_t m_started_at{0};
+};
+
+// Rates are raised one at a time: the peer switches as soon as the request
+// is taken and answers with the test pattern at the new rate. The
+// negotiation ends at the first rate that fails.
+class LinkNegotiator : public PatternNegotiator<LinkNegotiator> {
+ public:
+  LinkNegotiator(Receiver& receiver, systick::milliseconds_t timeout) noexcept;
+
+ private:
+  friend PatternNegotiator;
+
+  bool start(Transmitter& transmitter) noexcept;
+  bool apply(Transmitter& transmitter) noexcept;
+  [[nodiscard]] bool is_broken(const Transmitter&) const noexcept;
+  bool confirm(Transmitter& transmitter) noexcept;
+  void roll_back(Transmitter& transmitter) noexcept;
+
+ private:
+  Receiver& m_receiver;
+  std::size_t m_candidate{0};
+  std::size_t m_fallback{0};
+  std::uint32_t m_line_errors{0};
+};
+
+// The request goes in the handshake mode. Once the peer echoes it, the test
+// pattern is sent in a burst and the peer echoes the pattern. A peer that
+// doesn't know the request never sees a burst.
+class BurstNegotiator : public PatternNegotiator<BurstNegotiator> {
+ public:
+  explicit BurstNegotiator(systick::milliseconds_t timeout) noexcept;
+
+  // The peer has echoed the request
+  void Accept() noexcept;
+
+ private:
+  friend PatternNegotiator;
+
+  bool start(Transmitter& transmitter) noexcept;
+  bool apply(Transmitter& transmitter) noexcept;
+  [[nodiscard]] bool is_broken(const Transmitter& transmitter) const noexcept;
+  bool confirm(Transmitter& transmitter) noexcept;
+  void roll_back(Transmitter& transmitter) noexcept;
+
+ private:
+  bool m_accepted{false};
+};
+
+// Settles the link before anything else goes to the peer: the return rate,
+// then the burst mode, then the v2 protocol and the row codec. The protocol
+// requests aren't waited for, blocks switch over once the peer echoes them.
+class LinkSetup {
+ public:
+  enum class Status { Completed, InProgress };
+
+  struct Settings {
+    bool link_speed;
+    bool burst;
+    bool protocol_v2;
+    bool row_codec;
+    systick::milliseconds_t test_timeout;
+  };
+
+ public:
+  LinkSetup(Receiver& receiver, const Settings& settings) noexcept;
+
+  // Takes the whole data queue until completed
+  template <class DataQueue>
+  Status Step(Transmitter& transmitter, DataQueue& queue) noexcept {
+    if (m_link.has_value()) {
+      if (m_link->Update(transmitter, queue) ==
+          LinkNegotiator::Status::InProgress) {
+        return Status::InProgress;
+      }
+      m_link.reset();
+    }
+    if (m_burst.has_value()) {
+      if (m_burst->Update(transmitter, queue) ==
+          BurstNegotiator::Status::InProgress) {
+        return Status::InProgress;
+      }
+      m_burst.reset();
+    }
+    if (!m_protocol_requested) {
+      request_protocol(transmitter);
+    }
+    return Status::Completed;
+  }
+
+  // A link reply routed by the request parser
+  void OnReply(Transmitter& transmitter, const cmd::Command& reply) noexcept;
+
+ private:
+  void request_protocol(Transmitter& transmitter) noexcept;
+
+ private:
+  bool m_row_codec;
+  bool m_protocol_requested;
+  std::optional<LinkNegotiator> m_link;
+  std::optional<BurstNegotiator> m_burst;
+};
+}  // namespace io
@@ -8,24 +8,86 @@
 using namespace std;
 
 namespace io {
+namespace {
+constexpr uint32_t STREAM_FLAGS{DMA_LIFCR_CTCIF1 | DMA_LIFCR_CHTIF1 |
+                                DMA_LIFCR_CTEIF1 | DMA_LIFCR_CDMEIF1 |
+                                DMA_LIFCR_CFEIF1};
+
+template <class Ty>
+uint32_t to_address(Ty* ptr) noexcept {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr));
+}
+}  // namespace
+
 void Receiver::Listen(IListener* listener) noexcept {
-  set_transceiver_state(listener);
+  set_transceiver_state(false);
   m_listener = listener;
+  set_transceiver_state(listener);
+}
+
+void Receiver::SetSpeed(size_t speed_idx) noexcept {
+  assert(speed_idx < size(SPEEDS) && "unknown speed");
+  // BRR must not change while the receiver is enabled
+  const bool enabled{READ_BIT(m_transceiver->CR1, USART_CR1_UE) != 0};
+  CLEAR_BIT(m_transceiver->CR1, USART_CR1_UE);
+  WRITE_REG(m_transceiver->BRR, to_divider(SPEEDS[speed_idx]));
+  if (enabled) {
+    SET_BIT(m_transceiver->CR1, USART_CR1_UE);
+  }
+  m_speed_idx = speed_idx;
+}
+
+size_t Receiver::GetSpeed() const noexcept {
+  return m_speed_idx;
+}
+
+uint32_t Receiver::GetLineErrors() const noexcept {
+  return m_line_errors;
 }
 
 Receiver::Receiver() noexcept
-    : m_transceiver{setup_transceiver(SPEED_MANTISSA, SPEED_FRACTION)} {}
+    : m_transceiver{setup_transceiver(to_divider(SPEEDS[DEFAULT_SPEED_IDX]))},
+      m_stream{setup_stream(m_transceiver, data(m_buffer))} {}
 
 void Receiver::set_transceiver_state(bool on) noexcept {
   if (on) {
+    restart_stream();
     SET_BIT(m_transceiver->CR1, USART_CR1_UE);
   } else {
     CLEAR_BIT(m_transceiver->CR1, USART_CR1_UE);
   }
 }
 
-USART_TypeDef* Receiver::setup_transceiver(uint16_t mantissa,
-                                           uint16_t fraction) noexcept {
+void Receiver::restart_stream() noexcept {
+  CLEAR_BIT(m_stream->CR, DMA_SxCR_EN);
+  while (READ_BIT(m_stream->CR, DMA_SxCR_EN)) {
+  }
+  WRITE_REG(DMA2->LIFCR, STREAM_FLAGS);
+  WRITE_REG(m_stream->NDTR, static_cast<uint32_t>(BUFFER_SIZE));
+  m_read_pos = 0;
+  SET_BIT(m_stream->CR, DMA_SxCR_EN);
+}
+
+void Receiver::drain() noexcept {
+  // NDTR counts down and is reloaded after the last byte of the buffer
+  const size_t write_pos{(BUFFER_SIZE - READ_REG(m_stream->NDTR)) %
+                         BUFFER_SIZE};
+  if (write_pos < m_read_pos) {
+    dispatch(data(m_buffer) + m_read_pos, BUFFER_SIZE - m_read_pos);
+    m_read_pos = 0;
+  }
+  dispatch(data(m_buffer) + m_read_pos, write_pos - m_read_pos);
+  m_read_pos = write_pos;
+}
+
+void Receiver::dispatch(const byte* data, size_t count) noexcept {
+  assert(m_listener && "listener not found");
+  if (count > 0) {
+    m_listener->Process(data, count);
+  }
+}
+
+USART_TypeDef* Receiver::setup_transceiver(uint16_t divider) noexcept {
   auto& gpio{gpio::ChannelManager::GetInstance().Activate<gpio::Channel::G>()};
   SET_BIT(gpio.MODER, GPIO_MODER_MODER9_1);
   SET_BIT(gpio.PUPDR, GPIO_PUPDR_PUPDR9_0);
@@ -33,27 +95,80 @@ USART_TypeDef* Receiver::setup_transceiver(uint16_t mantissa,
 
   const auto transceiver{USART6};
   SET_BIT(RCC->APB2ENR, RCC_APB2ENR_USART6EN);
-  SET_BIT(transceiver->BRR, (mantissa << 4) | fraction);
-  SET_BIT(transceiver->CR3, USART_CR3_EIE);
-  SET_BIT(transceiver->CR1, USART_CR1_RE | USART_CR1_RXNEIE);
+  WRITE_REG(transceiver->BRR, divider);
+  SET_BIT(transceiver->CR3, USART_CR3_EIE | USART_CR3_DMAR);
+  SET_BIT(transceiver->CR1, USART_CR1_RE | USART_CR1_IDLEIE);
   NVIC_SetPriority(USART6_IRQn, INTERRUPT_PRIORITY);
   NVIC_EnableIRQ(USART6_IRQn);
 
   return transceiver;
 }
 
-void OnReceive(byte value) noexcept {
-  auto& listener{Receiver::GetInstance().m_listener};
-  assert(listener && "listener not found");
-  listener->Process(value);
+DMA_Stream_TypeDef* Receiver::setup_stream(USART_TypeDef* transceiver,
+                                           byte* buffer) noexcept {
+  const auto stream{DMA2_Stream1};
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA2EN);
+
+  CLEAR_BIT(stream->CR, DMA_SxCR_EN);
+  while (READ_BIT(stream->CR, DMA_SxCR_EN)) {
+  }
+
+  // Channel 5 (USART6_RX), peripheral-to-memory, bytes on both sides. The
+  // very high priority keeps display transfers from delaying reception.
+  // The stream is enabled once a listener appears.
+  WRITE_REG(stream->PAR, to_address(addressof(transceiver->DR)));
+  WRITE_REG(stream->M0AR, to_address(buffer));
+  WRITE_REG(stream->CR, DMA_SxCR_CHSEL_2 | DMA_SxCR_CHSEL_0 | DMA_SxCR_MINC |
+                            DMA_SxCR_CIRC | DMA_SxCR_PL | DMA_SxCR_HTIE |
+                            DMA_SxCR_TCIE | DMA_SxCR_TEIE);
+
+  // Both interrupts drain the buffer, so they must not preempt each other
+  NVIC_SetPriority(DMA2_Stream1_IRQn, INTERRUPT_PRIORITY);
+  NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+
+  return stream;
+}
+
+void OnReceive() noexcept {
+  Receiver::GetInstance().drain();
+}
+
+void OnLineError() noexcept {
+  auto& receiver{Receiver::GetInstance()};
+  receiver.m_line_errors = receiver.m_line_errors + 1;
+}
+
+void OnReceiveError() noexcept {
+  // The stream is disabled by the hardware on a transfer error
+  auto& receiver{Receiver::GetInstance()};
+  receiver.drain();
+  receiver.restart_stream();
 }
 }  // namespace io
 
 EXTERN_C void USART6_IRQHandler() {
-  if (!READ_BIT(USART6->SR, USART_SR_RXNE)) {
+  const uint32_t status{USART6->SR};
+  // IDLE and the error flags are cleared by reading DR after SR. A pending
+  // byte belongs to DMA, whose read of DR clears them just as well.
+  if (READ_BIT(status, USART_SR_IDLE | USART_SR_ORE | USART_SR_NE |
+                           USART_SR_FE) &&
+      !READ_BIT(status, USART_SR_RXNE)) {
     [[maybe_unused]] const auto value{USART6->DR};
-    // Do smth with error
-  } else {
-    io::OnReceive(static_cast<byte>(USART6->DR));
+  }
+  if (READ_BIT(status, USART_SR_ORE | USART_SR_NE | USART_SR_FE)) {
+    io::OnLineError();
+  }
+  if (READ_BIT(status, USART_SR_IDLE)) {
+    io::OnReceive();
+  }
+}
+
+EXTERN_C void DMA2_Stream1_IRQHandler() {
+  const uint32_t status{DMA2->LISR};
+  WRITE_REG(DMA2->LIFCR, io::STREAM_FLAGS);
+  if (READ_BIT(status, DMA_LISR_TEIF1)) {
+    io::OnReceiveError();
+  } else if (READ_BIT(status, DMA_LISR_HTIF1 | DMA_LISR_TCIF1)) {
+    io::OnReceive();
   }
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
+#include "io.hpp"
+
+#include <platform/systick.hpp>
 #include <tools/singleton.hpp>
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 
@@ -16,28 +20,88 @@ struct IListener {
   virtual ~IListener() = default;
 
   virtual void Process(std::byte value) = 0;
+
+  // Bytes received in a row, listeners are expected to handle them in bulk
+  virtual void Process(const std::byte* data, std::size_t count) {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+      Process(data[idx]);
+    }
+  }
 };
 
 class Receiver : public pv::Singleton<Receiver> {
-  static constexpr std::uint16_t SPEED_MANTISSA{8};
-  static constexpr std::uint16_t SPEED_FRACTION{11};
+  static constexpr std::uint32_t PERIPHERAL_CLOCK{16'000'000};  // APB2
   static constexpr std::uint8_t INTERRUPT_PRIORITY{14};
+  static constexpr std::uint32_t FRAME_BITS{10};  // 8N1
+
+  // DMA2 stream 1 writes the received bytes into a circular buffer. They
+  // are handed over on the half-transfer and transfer-complete interrupts
+  // and when the line goes idle, so a burst can't overwrite unread data
+  // as long as each half is drained in time.
+  static constexpr std::size_t BUFFER_SIZE{256};
+
+ public:
+  // Rates of the return path in the order the link negotiation tries them
+  static constexpr std::array<std::uint32_t, 4> SPEEDS{115'200, 230'400,
+                                                       460'800, 921'600};
+  static constexpr std::size_t DEFAULT_SPEED_IDX{0};
+
+  // Sent by the peer at a new rate before it's confirmed
+  static constexpr std::array<std::uint8_t, 16> TEST_PATTERN{
+      0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC,
+      0x01, 0x80, 0xFE, 0x7F, 0x5A, 0xA5, 0x3C, 0xC3};
 
  public:
   void Listen(IListener* listener) noexcept;
 
+  // Kept until changed again, reception continues at the new rate
+  void SetSpeed(std::size_t speed_idx) noexcept;
+  [[nodiscard]] std::size_t GetSpeed() const noexcept;
+  // Framing, noise and overrun errors since startup
+  [[nodiscard]] std::uint32_t GetLineErrors() const noexcept;
+
+  // The longest a NAK takes from the peer to the listener at a rate. It
+  // goes out after the v1 block the peer is sending, and as the line doesn't
+  // go idle while the peer streams rows back, it's handed over with the
+  // half of the buffer it ends up in.
+  static constexpr systick::microseconds_t GetNakLatency(
+      std::size_t speed_idx) noexcept {
+    constexpr std::size_t bytes_count{
+        1 + BlockHeader::MAX_LENGTH + ExtendedHeader::SIZE +
+        ExtendedHeader::CONTROL_LENGTH + BUFFER_SIZE / 2};
+    const std::uint32_t speed{SPEEDS[speed_idx]};
+    return static_cast<systick::microseconds_t>(
+        (bytes_count * FRAME_BITS * 1'000'000 + speed - 1) / speed);
+  }
+
  private:
-  friend void OnReceive(std::byte value) noexcept;
+  friend void OnReceive() noexcept;
+  friend void OnReceiveError() noexcept;
+  friend void OnLineError() noexcept;
   friend Singleton;
 
   Receiver() noexcept;
   void set_transceiver_state(bool on) noexcept;
+  void restart_stream() noexcept;
+  void drain() noexcept;
+  void dispatch(const std::byte* data, std::size_t count) noexcept;
+
+  // BRR holds the clock divider with 4 fraction bits (16x oversampling)
+  static constexpr std::uint16_t to_divider(std::uint32_t speed) noexcept {
+    return static_cast<std::uint16_t>((PERIPHERAL_CLOCK + speed / 2) / speed);
+  }
 
-  static USART_TypeDef* setup_transceiver(std::uint16_t mantissa,
-                                          std::uint16_t fraction) noexcept;
+  static USART_TypeDef* setup_transceiver(std::uint16_t divider) noexcept;
+  static DMA_Stream_TypeDef* setup_stream(USART_TypeDef* transceiver,
+                                          std::byte* buffer) noexcept;
 
  private:
+  std::array<std::byte, BUFFER_SIZE> m_buffer;
   USART_TypeDef* m_transceiver;
+  DMA_Stream_TypeDef* m_stream;
+  std::size_t m_read_pos{0};
+  std::size_t m_speed_idx{DEFAULT_SPEED_IDX};
+  volatile std::uint32_t m_line_errors{0};
   IListener* m_listener{nullptr};
 };
 }  // namespace io
\ No newline at end of file
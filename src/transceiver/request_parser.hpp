@@ -5,27 +5,75 @@
 
 #include <storage/circular.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
 
 namespace pv {
+// The peer sends v1 blocks back. Echoed link codes are queued apart from
+// the commands, as replies to the requests of this board. Extended (v2)
+// blocks are checked against their CRCs, only control ones are taken: a
+// NAK names the sequence id of a damaged block to be sent again. Extended
+// data and commands are skipped. The peer sends control blocks only, so a
+// damaged extended header can't be trusted for its length but is still
+// followed by a single control byte, which is dropped with it.
 template <std::size_t CommandQueueDepth, std::size_t DataQueueDepth>
 class RequestParser final : public io::IListener {
   template <std::size_t Depth, class Ty>
   using buffer_t = storage::CircularBuffer<Depth, Ty>;
 
+  static constexpr std::size_t NAK_QUEUE_DEPTH{16};
+  static constexpr std::size_t REPLY_QUEUE_DEPTH{8};
+  static constexpr std::size_t MAX_CONTROL_LENGTH{4};
+
  public:
   using cmd_buffer_t = buffer_t<CommandQueueDepth, cmd::Command>;
   using data_buffer_t = buffer_t<DataQueueDepth, std::byte>;
+  using nak_buffer_t = buffer_t<NAK_QUEUE_DEPTH, std::uint16_t>;
+  using reply_buffer_t = buffer_t<REPLY_QUEUE_DEPTH, cmd::Command>;
 
  public:
-  void Process(std::byte value) override {
-    if (auto& header = m_current_block; !header) {
-      header = deserialize<io::BlockHeader>(value);
-    } else {
-      dispatch(value);
-      if (--header->size == 0) {
+  void Process(std::byte value) override { Process(&value, 1); }
+
+  // The payload of a block is passed on in a single chunk
+  void Process(const std::byte* data, std::size_t count) override {
+    while (count > 0) {
+      if (m_extended_received > 0) {
+        collect_extended_header(*data++);
+        --count;
+        continue;
+      }
+      if (auto& extended = m_extended_block; extended) {
+        const std::size_t chunk{std::min(count, extended->size)};
+        collect_extended_payload(data, chunk);
+        data += chunk;
+        count -= chunk;
+        if ((extended->size -= chunk) == 0) {
+          complete_extended();
+          extended.reset();
+        }
+        continue;
+      }
+      auto& header{m_current_block};
+      if (!header) {
+        if (m_damaged_remaining > 0) {
+          --m_damaged_remaining;
+          ++data;
+        } else if (io::ExtendedHeader::IsExtended(*data)) {
+          collect_extended_header(*data++);
+        } else {
+          header = deserialize<io::BlockHeader>(*data++);
+        }
+        --count;
+        continue;
+      }
+      const std::size_t chunk{std::min(count, header->size)};
+      dispatch(data, chunk);
+      data += chunk;
+      count -= chunk;
+      if ((header->size -= chunk) == 0) {
         header.reset();
       }
     }
@@ -33,13 +81,64 @@ class RequestParser final : public io::IListener {
 
   cmd_buffer_t& GetCommands() noexcept { return m_commands; }
   data_buffer_t& GetData() noexcept { return m_data; }
+  nak_buffer_t& GetNaks() noexcept { return m_naks; }
+  reply_buffer_t& GetReplies() noexcept { return m_replies; }
+
+  // Extended blocks with a CRC mismatch in the header or the payload
+  [[nodiscard]] std::uint32_t GetCorruptedBlocks() const noexcept {
+    return m_corrupted;
+  }
 
  private:
-  void dispatch(std::byte value) noexcept {
+  void collect_extended_header(std::byte value) noexcept {
+    m_extended_raw[m_extended_received++] = value;
+    if (m_extended_received < io::ExtendedHeader::SIZE) {
+      return;
+    }
+    m_extended_received = 0;
+    m_extended_block = io::ExtendedHeader::Deserialize(
+        std::data(m_extended_raw), io::ExtendedHeader::SIZE);
+    if (!m_extended_block) {
+      ++m_corrupted;
+      m_damaged_remaining = io::ExtendedHeader::CONTROL_LENGTH;
+      return;
+    }
+    m_extended_crc = crc::CRC16_INIT;
+    m_control_length = 0;
+  }
+
+  void collect_extended_payload(const std::byte* data,
+                                std::size_t count) noexcept {
+    m_extended_crc = crc::Update16(m_extended_crc, data, count);
+    const std::size_t kept{
+        std::min(count, MAX_CONTROL_LENGTH - m_control_length)};
+    std::copy_n(data, kept, std::data(m_control) + m_control_length);
+    m_control_length += kept;
+  }
+
+  void complete_extended() noexcept {
+    const auto& header{*m_extended_block};
+    if (m_extended_crc != header.crc) {
+      ++m_corrupted;
+    } else if (header.kind == io::ExtendedHeader::Kind::Control &&
+               m_control[0] ==
+                   static_cast<std::byte>(io::ExtendedHeader::Control::Nak)) {
+      m_naks.produce(header.sequence);
+    }
+  }
+
+  void dispatch(const std::byte* data, std::size_t count) noexcept {
     if (m_current_block->category == io::BlockHeader::Category::Data) {
-      m_data.produce(value);
+      m_data.produce(data, count);
     } else {
-      m_commands.produce(deserialize<cmd::Command>(value).value());
+      for (std::size_t idx = 0; idx < count; ++idx) {
+        const auto command{deserialize<cmd::Command>(data[idx]).value()};
+        if (command.IsLinkReply()) {
+          m_replies.produce(command);
+        } else {
+          m_commands.produce(command);
+        }
+      }
     }
   }
 
@@ -51,6 +150,17 @@ class RequestParser final : public io::IListener {
  private:
   data_buffer_t m_data;
   cmd_buffer_t m_commands;
+  nak_buffer_t m_naks;
+  reply_buffer_t m_replies;
   std::optional<io::BlockHeader> m_current_block;
+
+  std::array<std::byte, io::ExtendedHeader::SIZE> m_extended_raw{};
+  std::size_t m_extended_received{0};
+  std::size_t m_damaged_remaining{0};
+  std::optional<io::ExtendedHeader> m_extended_block;
+  std::uint16_t m_extended_crc{0};
+  std::array<std::byte, MAX_CONTROL_LENGTH> m_control{};
+  std::size_t m_control_length{0};
+  std::uint32_t m_corrupted{0};
 };
 }  // namespace pv
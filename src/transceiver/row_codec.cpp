@@ -0,0 +1,166 @@
+#include "row_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace io {
+namespace {
+using pixel_t = array<uint8_t, RowCodec::PIXEL_SIZE>;
+
+constexpr uint8_t RUN_FLAG{0x80};
+constexpr size_t MAX_LITERALS{RUN_FLAG};
+constexpr size_t MIN_RUN{2};
+constexpr size_t MAX_RUN{RUN_FLAG + MIN_RUN - 1};
+
+pixel_t load_pixel(const byte* from) noexcept {
+  pixel_t pixel;
+  memcpy(data(pixel), from, sizeof(pixel_t));
+  return pixel;
+}
+
+pixel_t subtract(const pixel_t& lhs, const pixel_t& rhs) noexcept {
+  pixel_t result;
+  for (size_t idx = 0; idx < size(result); ++idx) {
+    result[idx] = static_cast<uint8_t>(lhs[idx] - rhs[idx]);
+  }
+  return result;
+}
+
+// The same PackBits flavour as the frame cache uses. Without an output
+// buffer the coded size is only counted.
+class Packer {
+ public:
+  explicit Packer(byte* out) noexcept : m_out{out} {}
+
+  void Push(const pixel_t& pixel) noexcept {
+    if (m_pending_count > 0 && m_pending_count < MAX_RUN &&
+        pixel == m_pending) {
+      ++m_pending_count;
+    } else {
+      flush_pending();
+      m_pending = pixel;
+      m_pending_count = 1;
+    }
+  }
+
+  size_t Finish() noexcept {
+    flush_pending();
+    close_literals();
+    return m_size;
+  }
+
+ private:
+  void flush_pending() noexcept {
+    if (m_pending_count >= MIN_RUN) {
+      close_literals();
+      put_header(static_cast<uint8_t>(RUN_FLAG + m_pending_count - MIN_RUN));
+      put_pixel(m_pending);
+    } else if (m_pending_count == 1) {
+      if (m_literals_count == 0) {
+        m_literals_header = m_size;
+        put_header(0);
+      }
+      put_pixel(m_pending);
+      if (++m_literals_count == MAX_LITERALS) {
+        close_literals();
+      }
+    }
+    m_pending_count = 0;
+  }
+
+  void close_literals() noexcept {
+    if (m_literals_count > 0 && m_out) {
+      m_out[m_literals_header] = static_cast<byte>(m_literals_count - 1);
+    }
+    m_literals_count = 0;
+  }
+
+  void put_header(uint8_t header) noexcept {
+    if (m_out) {
+      m_out[m_size] = static_cast<byte>(header);
+    }
+    ++m_size;
+  }
+
+  void put_pixel(const pixel_t& pixel) noexcept {
+    if (m_out) {
+      memcpy(m_out + m_size, data(pixel), sizeof(pixel_t));
+    }
+    m_size += sizeof(pixel_t);
+  }
+
+ private:
+  byte* m_out;
+  size_t m_size{0};
+  pixel_t m_pending{};
+  size_t m_pending_count{0};
+  size_t m_literals_header{0};
+  size_t m_literals_count{0};
+};
+}  // namespace
+
+optional<size_t> RowCodec::Encode(const byte* row,
+                                  size_t bytes_count) noexcept {
+  if (bytes_count % PIXEL_SIZE != 0 || bytes_count > MAX_ROW_SIZE) {
+    return nullopt;
+  }
+  Filter best{Filter::None};
+  size_t best_size{pack(Filter::None, row, bytes_count, nullptr)};
+  for (const auto filter : {Filter::Left, Filter::Up}) {
+    if (filter == Filter::Up && m_reference_size != bytes_count) {
+      continue;
+    }
+    if (const size_t packed = pack(filter, row, bytes_count, nullptr);
+        packed < best_size) {
+      best = filter;
+      best_size = packed;
+    }
+  }
+  const size_t coded_size{sizeof(Filter) + best_size};
+  if (coded_size >= bytes_count) {
+    return nullopt;
+  }
+  m_coded[0] = static_cast<byte>(best);
+  pack(best, row, bytes_count, data(m_coded) + sizeof(Filter));
+  return coded_size;
+}
+
+const byte* RowCodec::GetCoded() const noexcept {
+  return data(m_coded);
+}
+
+void RowCodec::SetReference(const byte* row, size_t bytes_count) noexcept {
+  m_reference_size = min(bytes_count, MAX_ROW_SIZE);
+  memcpy(data(m_reference), row, m_reference_size);
+}
+
+void RowCodec::Reset() noexcept {
+  m_reference_size = 0;
+}
+
+size_t RowCodec::pack(Filter filter,
+                      const byte* row,
+                      size_t bytes_count,
+                      byte* out) const noexcept {
+  Packer packer{out};
+  pixel_t previous{};
+  for (size_t offset = 0; offset < bytes_count; offset += PIXEL_SIZE) {
+    const pixel_t pixel{load_pixel(row + offset)};
+    switch (filter) {
+      case Filter::None:
+        packer.Push(pixel);
+        break;
+      case Filter::Left:
+        packer.Push(subtract(pixel, previous));
+        break;
+      case Filter::Up:
+        packer.Push(subtract(pixel, load_pixel(data(m_reference) + offset)));
+        break;
+    }
+    previous = pixel;
+  }
+  return packer.Finish();
+}
+}  // namespace io
\ No newline at end of file
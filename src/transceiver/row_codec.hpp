@@ -0,0 +1,47 @@
+#pragma once
+#include "io.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace io {
+// Rows of BGR888 pixels in v2 data blocks flagged as coded: a filter byte
+// followed by PackBits over the filtered pixels (a header below 0x80 is
+// followed by header + 1 literal pixels, otherwise a single pixel is
+// repeated header - 0x80 + 2 times). The left filter subtracts the previous
+// pixel, the up one the same pixel of the reference row, byte by byte
+// modulo 256. The reference is the last row the peer has decoded, and only
+// a row of the same size may be referred to. Rows that don't get shorter
+// are sent as they are.
+class RowCodec {
+  static constexpr std::size_t MAX_ROW_SIZE{ExtendedHeader::MAX_LENGTH};
+
+ public:
+  static constexpr std::size_t PIXEL_SIZE{3};
+
+  enum class Filter : std::uint8_t { None = 0x0, Left = 0x1, Up = 0x2 };
+
+ public:
+  // The size of the coded row if it's shorter than the original one
+  [[nodiscard]] std::optional<std::size_t> Encode(
+      const std::byte* row,
+      std::size_t bytes_count) noexcept;
+  [[nodiscard]] const std::byte* GetCoded() const noexcept;
+
+  void SetReference(const std::byte* row, std::size_t bytes_count) noexcept;
+  void Reset() noexcept;
+
+ private:
+  std::size_t pack(Filter filter,
+                   const std::byte* row,
+                   std::size_t bytes_count,
+                   std::byte* out) const noexcept;
+
+ private:
+  std::array<std::byte, MAX_ROW_SIZE> m_reference;
+  std::size_t m_reference_size{0};
+  std::array<std::byte, MAX_ROW_SIZE> m_coded;
+};
+}  // namespace io
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 #include <tools/attributes.hpp>
 
+#include <cassert>
+#include <cstring>
+
 using namespace std;
 
 namespace io {
@@ -10,45 +13,175 @@ Transmitter& Transmitter::GetInstance() noexcept {
   return transmitter;
 }
 
-void Transmitter::SendData(const byte* buffer, size_t bytes_count) {
-  while (bytes_count > MAX_BLOCK_LENGTH) {
-    send_chunk(BlockHeader::Category::Data, buffer, MAX_BLOCK_LENGTH);
-    buffer += MAX_BLOCK_LENGTH;
-    bytes_count -= MAX_BLOCK_LENGTH;
+auto Transmitter::SendData(const byte* buffer, size_t bytes_count) noexcept
+    -> optional<ticket_t> {
+  // Only rows are referred to by the codec
+  m_codec.Reset();
+  return push_data(buffer, bytes_count);
+}
+
+auto Transmitter::push_data(const byte* buffer, size_t bytes_count) noexcept
+    -> optional<ticket_t> {
+  const bool extended{m_protocol == Protocol::V2};
+  const size_t max_length{extended ? ExtendedHeader::MAX_LENGTH
+                                   : MAX_BLOCK_LENGTH};
+  const size_t blocks_count{(bytes_count + max_length - 1) / max_length};
+  assert(blocks_count > 0 && blocks_count < QUEUE_DEPTH &&
+         "buffer doesn't fit the queue");
+  if (!m_port.HasRoom(blocks_count) ||
+      (extended && !m_port.HasHistoryRoom(blocks_count))) {
+    return nullopt;
+  }
+  ticket_t ticket{};
+  while (bytes_count > 0) {
+    const size_t chunk_size{min(bytes_count, max_length)};
+    ticket = m_port.Push(
+        extended ? make_extended_block(buffer, chunk_size, m_sequence++)
+                 : make_block(BlockHeader::Category::Data, buffer, chunk_size));
+    buffer += chunk_size;
+    bytes_count -= chunk_size;
+  }
+  return ticket;
+}
+
+bool Transmitter::IsReleased(ticket_t ticket) const noexcept {
+  return m_port.IsReleased(ticket);
+}
+
+auto Transmitter::SendRow(byte* buffer, size_t bytes_count) noexcept
+    -> optional<ticket_t> {
+  if (!m_codec_enabled || m_protocol != Protocol::V2 ||
+      bytes_count > ExtendedHeader::MAX_LENGTH) {
+    return SendData(buffer, bytes_count);
+  }
+  // The caller retries with the same row if there is no room
+  if (!m_port.HasRoom(1) || !m_port.HasHistoryRoom(1)) {
+    return nullopt;
+  }
+  const auto coded_size{m_codec.Encode(buffer, bytes_count)};
+  m_codec.SetReference(buffer, bytes_count);
+  if (!coded_size) {
+    return push_data(buffer, bytes_count);
   }
-  if (bytes_count) {
-    send_chunk(BlockHeader::Category::Data, buffer, bytes_count);
+  memcpy(buffer, m_codec.GetCoded(), *coded_size);
+  return m_port.Push(
+      make_extended_block(buffer, *coded_size, m_sequence++, true));
+}
+
+void Transmitter::SetProtocol(Protocol protocol) noexcept {
+  m_protocol = protocol;
+  m_codec.Reset();
+}
+
+auto Transmitter::GetProtocol() const noexcept -> Protocol {
+  return m_protocol;
+}
+
+void Transmitter::SetRowCodec(bool enabled) noexcept {
+  m_codec_enabled = enabled;
+  m_codec.Reset();
+}
+
+auto Transmitter::Resend(uint16_t sequence) noexcept -> ResendStatus {
+  const auto status{m_port.Resend(sequence)};
+  if (status == ResendStatus::Expired) {
+    if (!m_port.HasCommandRoom()) {
+      return ResendStatus::NoRoom;
+    }
+    m_port.PushSkip(
+        make_control_block(ExtendedHeader::Control::Skip, sequence));
   }
+  // The peer takes the resent block, or the row repeated in place of the
+  // skipped one, as the last row
+  m_codec.Reset();
+  return status;
+}
+
+void Transmitter::SetReturnLatency(systick::microseconds_t latency) noexcept {
+  m_port.SetNakWindow(to_nak_window(latency));
+}
+
+void Transmitter::BeginFrame() noexcept {
+  m_codec.Reset();
 }
 
 void Transmitter::SendCommand(cmd::Command* command, size_t count) {
-  using chunk_t = array<serialized_command_t,
-                        MAX_BLOCK_LENGTH / sizeof(serialized_command_t)>;
+  constexpr size_t chunk_capacity{details::Block::INLINE_CAPACITY /
+                                  sizeof(serialized_command_t)};
 
   constexpr auto serializer{[](cmd::Command target) {
     return static_cast<const Serializable<cmd::Command>&>(target).Serialize();
   }};
 
   while (count > 0) {
-    chunk_t chunk;
-    const size_t chunk_size{min(count, size(chunk))};
-
+    const size_t chunk_size{min(count, chunk_capacity)};
+    auto block{make_block(BlockHeader::Category::Command, nullptr,
+                          chunk_size * sizeof(serialized_command_t))};
     for (size_t idx = 0; idx < chunk_size; ++idx) {
-      chunk[idx] = serializer(*command++);
+      const serialized_command_t value{serializer(*command++)};
+      memcpy(data(block.payload) + idx * sizeof(value), addressof(value),
+             sizeof(value));
     }
-    send_chunk(BlockHeader::Category::Command,
-               reinterpret_cast<const byte*>(data(chunk)),
-               chunk_size * sizeof(serialized_command_t));
+    while (!m_port.HasCommandRoom()) {
+    }
+    m_port.PushCommand(block);
     count -= chunk_size;
   }
 }
 
-void Transmitter::send_chunk(BlockHeader::Category category,
-                             const byte* buffer,
-                             size_t bytes_count) {
-  const BlockHeader header{category, static_cast<uint8_t>(bytes_count)};
-  m_port.Transfer(header);
-  m_port.Transfer(buffer, bytes_count);
+bool Transmitter::IsIdle() const noexcept {
+  return m_port.IsIdle();
+}
+
+auto Transmitter::GetStatistics() const noexcept -> const Statistics& {
+  return m_port.GetStatistics();
+}
+
+bool Transmitter::SetMode(Mode mode) noexcept {
+  return m_port.SetMode(mode);
+}
+
+auto Transmitter::GetMode() const noexcept -> Mode {
+  return m_port.GetMode();
+}
+
+details::Block Transmitter::make_block(BlockHeader::Category category,
+                                       const byte* buffer,
+                                       size_t bytes_count) noexcept {
+  const BlockHeader header{category, bytes_count};
+  return details::Block{buffer,
+                        {static_cast<byte>(header.Serialize())},
+                        1,
+                        static_cast<uint16_t>(bytes_count),
+                        {},
+                        nullopt};
+}
+
+details::Block Transmitter::make_extended_block(const byte* buffer,
+                                                size_t bytes_count,
+                                                uint16_t sequence,
+                                                bool coded) noexcept {
+  const ExtendedHeader header{ExtendedHeader::Kind::Data, bytes_count,
+                              sequence, coded};
+  return details::Block{buffer,
+                        header.Serialize(buffer),
+                        static_cast<uint8_t>(ExtendedHeader::SIZE),
+                        static_cast<uint16_t>(bytes_count),
+                        {},
+                        sequence};
+}
+
+details::Block Transmitter::make_control_block(ExtendedHeader::Control control,
+                                               uint16_t sequence) noexcept {
+  const byte code{static_cast<byte>(control)};
+  const ExtendedHeader header{ExtendedHeader::Kind::Control,
+                              ExtendedHeader::CONTROL_LENGTH, sequence};
+  return details::Block{nullptr,
+                        header.Serialize(&code),
+                        static_cast<uint8_t>(ExtendedHeader::SIZE),
+                        static_cast<uint16_t>(ExtendedHeader::CONTROL_LENGTH),
+                        {code},
+                        nullopt};
 }
 
 void OnOverwrite() noexcept {
@@ -65,6 +198,11 @@ void OnReadyToSend() noexcept {
   auto& transmitter{Transmitter::GetInstance()};
   transmitter.m_port.SetReady();
 }
+
+void OnBurstError() noexcept {
+  auto& transmitter{Transmitter::GetInstance()};
+  transmitter.m_port.Abort();
+}
 }  // namespace io
 
 EXTERN_C void EXTI9_5_IRQHandler() {
@@ -80,4 +218,9 @@ EXTERN_C void EXTI9_5_IRQHandler() {
 EXTERN_C void TIM6_IRQHandler() {
   io::OnReadyToSend();
   CLEAR_BIT(TIM6->SR, TIM_SR_UIF);
+}
+
+EXTERN_C void DMA2_Stream5_IRQHandler() {
+  WRITE_REG(DMA2->HIFCR, DMA_HIFCR_CTEIF5);
+  io::OnBurstError();
 }
\ No newline at end of file
@@ -1,94 +1,451 @@
 #pragma once
 #include "command.hpp"
 #include "io.hpp"
+#include "receiver.hpp"
+#include "row_codec.hpp"
 
-#include <display/lcd.hpp>
-#include <filesystem/bmp.hpp>
 #include <platform/event.hpp>
 #include <platform/gpio.hpp>
+#include <platform/systick.hpp>
 #include <storage/circular.hpp>
 
 #include <tools/singleton.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstddef>
 #include <limits>
+#include <optional>
 #include <utility>
 
 #include <stm32f4xx.h>
 
 namespace io {
 namespace details {
+// The header and the payload of a protocol block. Commands are kept
+// inline, data is read straight from the caller's buffer.
+struct Block {
+  static constexpr std::size_t INLINE_CAPACITY{4};
+
+  const std::byte* data;  // nullptr - the payload is inline
+  std::array<std::byte, ExtendedHeader::SIZE> header;
+  std::uint8_t header_length;
+  std::uint16_t length;
+  std::array<std::byte, INLINE_CAPACITY> payload;
+  std::optional<std::uint16_t> sequence;  // v2 blocks, kept for a NAK
+};
+
+// The pass delay between a byte and its strobe starts at the configured
+// value and is halved after every SHRINK_INTERVAL bytes taken in a row,
+// but never below the fastest CTS response: a peer that needs that long to
+// answer a strobe needs about as long to take the next byte. Only an
+// overwrite reported by the peer backs it off again, so the delay settles
+// near the pace the peer can actually keep up with.
+//
+// In the burst mode TIM1 paces DMA2 stream 5, which writes two BSRR words
+// per byte (the data with RTS low, then RTS high) and the peer answers a
+// whole block with a single CTS. An overwrite means the peer has dropped
+// the block, so it's passed again byte by byte and the port stays in the
+// handshake mode.
+//
+// Command blocks have a lane of their own, which is drained first whenever
+// a block is finished. A command waits for the block being passed at most
+// (and the rest of a burst), not for the data queued behind it.
+//
+// Data blocks are released in order once their last byte is read, a ticket
+// is the number of data blocks queued so far. Blocks with a sequence id
+// stay in the history for the NAK window and hold back their tickets
+// meanwhile, so a NAK can queue them again while the caller's buffer is
+// intact. A history slot is reserved when such a block is queued, so no
+// block is forgotten inside its window however fast they are passed. A
+// NAK for a block past its window is answered with a skip control block in
+// the command lane, as the peer decodes in order and would wait for it.
 template <std::size_t QueueDepth>
 class ParallelPort {
+  static constexpr std::uint16_t SHRINK_INTERVAL{64};
+  static constexpr std::size_t BURST_LENGTH{BlockHeader::MAX_LENGTH};
+  static constexpr std::size_t HISTORY_DEPTH{16};
+  static constexpr std::size_t COMMAND_DEPTH{8};
+
  public:
+  enum class Mode { Handshake, Burst };
+  enum class ResendStatus { Queued, NoRoom, Expired };
+
+  using ticket_t = std::uint32_t;
+
   struct Settings {
-    std::uint16_t pass_delay;
-    std::uint16_t retry_delay;
+    std::uint16_t pass_delay;   // the initial and the largest one
+    std::uint16_t retry_delay;  // the largest one
+    std::uint32_t burst_rate;   // bytes per second
+    systick::milliseconds_t nak_window;
+  };
+
+  struct Statistics {
+    std::uint16_t pass_delay;    // current, in microseconds
+    std::uint16_t min_response;  // the fastest CTS after RTS
+    std::uint32_t bytes_passed;
+    std::uint32_t retries;
+    std::uint32_t bursts;
+    std::uint32_t fallbacks;  // bursts returned to the handshake mode
+    std::uint32_t resent;     // blocks queued again on a NAK
+    std::uint32_t skipped;    // blocks NAKed past their window
+  };
+
+ private:
+  struct Sent {
+    Block block;
+    ticket_t ticket;
+    systick::milliseconds_t released_at;
+    bool resending;  // kept until sent again
+    bool requeued;
   };
 
  public:
   ParallelPort(Settings settings, std::uint8_t interrupt_priority) noexcept
       : m_settings{settings},
-        m_timer{setup_transaction_timer(interrupt_priority)} {
+        m_timer{setup_transaction_timer(interrupt_priority)},
+        m_statistics{settings.pass_delay,
+                     std::numeric_limits<std::uint16_t>::max(),
+                     0,
+                     0,
+                     0,
+                     0,
+                     0,
+                     0},
+        m_retry_delay{settings.retry_delay} {
     prepare_gpio();
     listen_cts_and_ov(interrupt_priority);
+    setup_burst(settings.burst_rate, interrupt_priority);
+  }
+
+  [[nodiscard]] bool HasRoom(std::size_t blocks_count) const noexcept {
+    // A slot is kept free, so a full queue isn't taken for an empty one
+    return m_blocks.size() + blocks_count < QueueDepth;
+  }
+
+  // Blocks with a sequence id need a history slot each as well
+  [[nodiscard]] bool HasHistoryRoom(std::size_t blocks_count) const noexcept {
+    mask_interrupts(true);
+    const auto kept{static_cast<std::size_t>(std::count_if(
+        std::begin(m_history), std::end(m_history),
+        [this](const std::optional<Sent>& entry) {
+          return entry && is_kept(*entry);
+        }))};
+    const std::size_t in_flight{m_sequenced_queued - m_sequenced_remembered};
+    mask_interrupts(false);
+    return kept + in_flight + blocks_count <= HISTORY_DEPTH;
   }
 
-  void Transfer(const std::byte* buffer, std::size_t bytes_count) noexcept {
-    while (bytes_count > 0) {
-      bytes_count -= m_buffer.produce(buffer, bytes_count);
-      start_transmission();
+  // The room must be checked beforehand
+  ticket_t Push(const Block& block) noexcept {
+    if (block.sequence) {
+      ++m_sequenced_queued;
     }
+    m_blocks.produce(block);
+    start_transmission();
+    return ++m_queued;
+  }
+
+  [[nodiscard]] bool HasCommandRoom() const noexcept {
+    return m_commands.size() + 1 < COMMAND_DEPTH;
   }
 
-  template <class... Types>
-  void Transfer(const Serializable<Types>&... values) {
-    std::array buffer{values.Serialize()...};
-    Transfer(reinterpret_cast<const std::byte*>(std::data(buffer)),
-             std::size(buffer));
+  // Goes ahead of the data blocks, the room must be checked beforehand
+  void PushCommand(const Block& block) noexcept {
+    m_commands.produce(block);
+    start_transmission();
+  }
+
+  [[nodiscard]] bool IsReleased(ticket_t ticket) const noexcept {
+    if (static_cast<std::int32_t>(m_released - ticket) < 0) {
+      return false;
+    }
+    mask_interrupts(true);
+    const bool released{std::none_of(
+        std::begin(m_history), std::end(m_history),
+        [this, ticket](const std::optional<Sent>& entry) {
+          return entry &&
+                 static_cast<std::int32_t>(ticket - entry->ticket) >= 0 &&
+                 is_kept(*entry);
+        })};
+    mask_interrupts(false);
+    return released;
+  }
+
+  // Without room the block is kept until the NAK is retried. A block that
+  // is queued again or not sent yet is on its way already.
+  ResendStatus Resend(std::uint16_t sequence) noexcept {
+    bool found{false};
+    bool pending{false};
+    std::optional<Block> block;
+    mask_interrupts(true);
+    for (auto& entry : m_history) {
+      if (entry && entry->block.sequence == sequence && is_kept(*entry)) {
+        found = true;
+        pending = entry->requeued;
+        entry->resending = true;
+        if (!pending && HasRoom(1)) {
+          entry->requeued = true;
+          block = entry->block;
+        }
+        break;
+      }
+    }
+    if (!found) {
+      pending = !m_last_sent || static_cast<std::int16_t>(
+                                    sequence - *m_last_sent) > 0;
+    }
+    mask_interrupts(false);
+    if (pending) {
+      return ResendStatus::Queued;
+    }
+    if (!found) {
+      return ResendStatus::Expired;
+    }
+    if (!block) {
+      return ResendStatus::NoRoom;
+    }
+    Push(*block);
+    ++m_statistics.resent;
+    return ResendStatus::Queued;
+  }
+
+  // Goes ahead of the data blocks, the room must be checked beforehand
+  void PushSkip(const Block& block) noexcept {
+    ++m_statistics.skipped;
+    PushCommand(block);
+  }
+
+  void SetNakWindow(systick::milliseconds_t window) noexcept {
+    m_settings.nak_window = window;
   }
 
   void PassNext() noexcept {
     switch_rts(false);
-    if (const auto value = m_buffer.consume(); !value) {
+    if (m_mode == Mode::Burst) {
+      m_statistics.bytes_passed += static_cast<std::uint32_t>(m_burst_length);
+      ++m_statistics.bursts;
+      m_active = start_burst();
+      return;
+    }
+    on_passed();
+    if (const auto value = next_byte(); !value) {
       m_active = false;
     } else {
       start_transmission_unchecked(*value);
     }
   }
 
-  void Retry() const noexcept {
+  void Retry() noexcept {
+    if (m_mode == Mode::Burst) {
+      fall_back();
+      return;
+    }
     // RTS high -> RTS low -> RTS high
     switch_rts(false);
-    schedule_transaction(m_settings.retry_delay);
+    on_overwrite();
+    schedule_transaction(m_retry_delay);
   }
 
-  void SetReady() const noexcept { switch_rts(true); }
+  void SetReady() noexcept {
+    m_strobed_at = systick::Clock::GetInstance().NowUs();
+    switch_rts(true);
+  }
+
+  // A burst has failed on the DMA side
+  void Abort() noexcept {
+    if (m_mode == Mode::Burst) {
+      fall_back();
+    }
+  }
+
+  // The burst mode may only be entered when everything queued is taken
+  [[nodiscard]] bool SetMode(Mode mode) noexcept {
+    if (mode == m_mode) {
+      return true;
+    }
+    if (mode == Mode::Burst) {
+      if (!IsIdle()) {
+        return false;
+      }
+      m_mode = Mode::Burst;
+    } else {
+      mask_interrupts(true);
+      fall_back();
+      mask_interrupts(false);
+    }
+    return true;
+  }
+
+  [[nodiscard]] Mode GetMode() const noexcept { return m_mode; }
+
+  [[nodiscard]] bool IsIdle() const noexcept { return !m_active; }
+
+  [[nodiscard]] const Statistics& GetStatistics() const noexcept {
+    return m_statistics;
+  }
 
  private:
   void start_transmission() noexcept {
-    if (!m_active) {
-      if (const auto value = m_buffer.consume(); value) {
-        m_active = true;
-        start_transmission_unchecked(*value);
+    if (m_active) {
+      return;
+    }
+    if (m_mode == Mode::Burst) {
+      m_active = start_burst();
+    } else if (const auto value = next_byte(); value) {
+      m_active = true;
+      start_transmission_unchecked(*value);
+    }
+  }
+
+  // Bytes of a dropped burst go first
+  std::optional<std::byte> next_byte() noexcept {
+    if (m_replay_idx < m_replay_length) {
+      const std::uint32_t word{m_burst[2 * m_replay_idx++]};
+      return static_cast<std::byte>(word >> 8 & 0xFF);
+    }
+    if (!m_current) {
+      m_current = m_commands.consume();
+      m_current_command = m_current.has_value();
+      if (!m_current) {
+        m_current = m_blocks.consume();
       }
+      if (!m_current) {
+        return std::nullopt;
+      }
+      m_position = 0;
+    }
+    const Block& block{*m_current};
+    const std::byte* payload{block.data ? block.data
+                                        : std::data(block.payload)};
+    const std::byte value{m_position < block.header_length
+                              ? block.header[m_position]
+                              : payload[m_position - block.header_length]};
+    if (++m_position == block.header_length + block.length) {
+      if (block.sequence) {
+        remember(block);
+      }
+      if (!m_current_command) {
+        m_released = m_released + 1;
+      }
+      m_current.reset();
+    }
+    return value;
+  }
+
+  void remember(const Block& block) noexcept {
+    const auto now{systick::Clock::GetInstance().Now()};
+    m_sequenced_remembered = m_sequenced_remembered + 1;
+    for (auto& entry : m_history) {
+      if (entry && entry->requeued &&
+          entry->block.sequence == block.sequence) {
+        entry->released_at = now;  // Sent again
+        entry->resending = false;
+        entry->requeued = false;
+        return;
+      }
+    }
+    m_last_sent = block.sequence;
+    // Reserved when the block was queued
+    const auto slot{std::find_if(std::begin(m_history), std::end(m_history),
+                                 [this](const std::optional<Sent>& entry) {
+                                   return !entry || !is_kept(*entry);
+                                 })};
+    assert(slot != std::end(m_history) && "history is full");
+    *slot = Sent{block, m_released + 1, now, false, false};
+  }
+
+  [[nodiscard]] bool is_kept(const Sent& entry) const noexcept {
+    return entry.resending ||
+           systick::Clock::GetInstance().Now() - entry.released_at <
+               m_settings.nak_window;
+  }
+
+  bool start_burst() noexcept {
+    stop_burst();
+    std::size_t length{0};
+    for (; length < BURST_LENGTH; ++length) {
+      const auto value{next_byte()};
+      if (!value) {
+        break;
+      }
+      m_burst[2 * length] = format_byte(*value) | GPIO_BSRR_BR_7;
+      m_burst[2 * length + 1] = GPIO_BSRR_BS_7;
+    }
+    if (!length) {
+      return false;
+    }
+    m_burst_length = length;
+    WRITE_REG(DMA2->HIFCR, DMA_HIFCR_CTCIF5 | DMA_HIFCR_CHTIF5 |
+                               DMA_HIFCR_CTEIF5 | DMA_HIFCR_CDMEIF5 |
+                               DMA_HIFCR_CFEIF5);
+    WRITE_REG(m_burst_stream->NDTR, 2 * length);
+    SET_BIT(m_burst_stream->CR, DMA_SxCR_EN);
+    m_burst_timer->CNT = 0;
+    SET_BIT(m_burst_timer->CR1, TIM_CR1_CEN);
+    return true;
+  }
+
+  void stop_burst() const noexcept {
+    CLEAR_BIT(m_burst_timer->CR1, TIM_CR1_CEN);
+    CLEAR_BIT(m_burst_stream->CR, DMA_SxCR_EN);
+    while (READ_BIT(m_burst_stream->CR, DMA_SxCR_EN)) {
+    }
+  }
+
+  void fall_back() noexcept {
+    stop_burst();
+    switch_rts(false);
+    m_mode = Mode::Handshake;
+    ++m_statistics.fallbacks;
+    if (m_active) {
+      // The peer drops the whole block
+      m_replay_idx = 0;
+      m_replay_length = m_burst_length;
+      start_transmission_unchecked(*next_byte());
     }
   }
 
   void start_transmission_unchecked(std::byte value) noexcept {
     expose_data(value);
-    schedule_transaction(m_settings.pass_delay);
+    schedule_transaction(m_statistics.pass_delay);
   }
 
-  void schedule_transaction(std::uint16_t us) const noexcept {
+  void schedule_transaction(std::uint16_t us) noexcept {
     if (!us) {
-      switch_rts(true);
+      SetReady();
     } else {
       set_one_pulse_timer(us);
     }
   }
 
+  void on_passed() noexcept {
+    const auto response{systick::Clock::GetInstance().NowUs() - m_strobed_at};
+    m_statistics.min_response = static_cast<std::uint16_t>(
+        std::min<systick::microseconds_t>(m_statistics.min_response,
+                                          response));
+    ++m_statistics.bytes_passed;
+    if (++m_streak == SHRINK_INTERVAL) {
+      m_streak = 0;
+      const std::uint16_t delay{m_statistics.pass_delay};
+      m_statistics.pass_delay = std::min(
+          delay, std::max<std::uint16_t>(delay / 2, m_statistics.min_response));
+    }
+  }
+
+  void on_overwrite() noexcept {
+    ++m_statistics.retries;
+    m_streak = 0;
+    const std::uint32_t backed_off{2u * m_statistics.pass_delay + 1};
+    m_statistics.pass_delay = static_cast<std::uint16_t>(
+        std::min<std::uint32_t>(backed_off, m_settings.pass_delay));
+    // The peer gets about as long as it takes to answer a strobe
+    m_retry_delay = static_cast<std::uint16_t>(std::min<std::uint32_t>(
+        m_statistics.pass_delay + m_statistics.min_response,
+        m_settings.retry_delay));
+  }
+
   void set_one_pulse_timer(std::uint16_t us) const noexcept {
     m_timer->CNT = 0;
     m_timer->ARR = us;
@@ -122,6 +479,45 @@ class ParallelPort {
                             GPIO_PUPDR_PUPDR14_1 | GPIO_PUPDR_PUPDR15_1);
   }
 
+  void setup_burst(std::uint32_t rate,
+                   std::uint8_t interrupt_priority) noexcept {
+    auto& channel_manager{gpio::ChannelManager::GetInstance()};
+    auto& gpio{channel_manager.Get<gpio::Channel::B>()};
+
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA2EN);
+    stop_burst();
+    // Channel 6 (TIM1_UP), memory-to-peripheral, words on both sides
+    WRITE_REG(m_burst_stream->PAR, to_address(std::addressof(gpio.BSRR)));
+    WRITE_REG(m_burst_stream->M0AR, to_address(std::data(m_burst)));
+    WRITE_REG(m_burst_stream->CR, DMA_SxCR_CHSEL_2 | DMA_SxCR_CHSEL_1 |
+                                      DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1 |
+                                      DMA_SxCR_MINC | DMA_SxCR_DIR_0 |
+                                      DMA_SxCR_TEIE);
+    NVIC_SetPriority(DMA2_Stream5_IRQn, interrupt_priority);
+    NVIC_EnableIRQ(DMA2_Stream5_IRQn);
+
+    // Two words per byte
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM1EN);
+    m_burst_timer->PSC = 0;
+    m_burst_timer->ARR = SystemCoreClock / (2 * rate) - 1;
+    SET_BIT(m_burst_timer->DIER, TIM_DIER_UDE);
+  }
+
+  static void mask_interrupts(bool masked) noexcept {
+    for (const auto irq : {EXTI9_5_IRQn, TIM6_IRQn, DMA2_Stream5_IRQn}) {
+      if (masked) {
+        NVIC_DisableIRQ(irq);
+      } else {
+        NVIC_EnableIRQ(irq);
+      }
+    }
+  }
+
+  template <class Ty>
+  static std::uint32_t to_address(Ty* ptr) noexcept {
+    return static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(ptr));
+  }
+
   static TIM_TypeDef* setup_transaction_timer(std::uint8_t interrupt_priority) {
     TIM_TypeDef* timer{TIM6};
     SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM6EN);
@@ -152,50 +548,121 @@ class ParallelPort {
     }
   }
 
+  // Sets the ones and resets the zeros of PB8-PB15 in a single write
+  static constexpr std::uint32_t format_byte(std::byte value) noexcept {
+    const auto bits{static_cast<std::uint32_t>(value) << 8};
+    return bits | (~bits & 0xFF00) << 16;
+  }
+
   static void expose_data(std::byte value) noexcept {
     auto& channel_manager{gpio::ChannelManager::GetInstance()};
-    auto& odr{channel_manager.Get<gpio::Channel::B>().ODR};
-    odr = (odr & 0xFFFF00FF) | (static_cast<std::uint16_t>(value) << 8);
+    channel_manager.Get<gpio::Channel::B>().BSRR = format_byte(value);
   }
 
  private:
-  storage::CircularBuffer<QueueDepth, std::byte> m_buffer;
+  storage::CircularBuffer<QueueDepth, Block> m_blocks;
+  storage::CircularBuffer<COMMAND_DEPTH, Block> m_commands;
+  std::optional<Block> m_current;
+  bool m_current_command{false};
+  std::size_t m_position{0};
+  ticket_t m_queued{0};
+  volatile ticket_t m_released{0};
+  std::array<std::optional<Sent>, HISTORY_DEPTH> m_history{};
+  std::uint32_t m_sequenced_queued{0};
+  volatile std::uint32_t m_sequenced_remembered{0};
+  std::optional<std::uint16_t> m_last_sent;  // blocks are first sent in order
   Settings m_settings;
   TIM_TypeDef* m_timer;
   volatile bool m_active{false};
+  Statistics m_statistics;
+  std::uint16_t m_retry_delay;
+  std::uint16_t m_streak{0};
+  systick::microseconds_t m_strobed_at{0};
+  std::array<std::uint32_t, 2 * BURST_LENGTH> m_burst{};
+  std::size_t m_burst_length{0};
+  std::size_t m_replay_idx{0}, m_replay_length{0};
+  volatile Mode m_mode{Mode::Handshake};
+  DMA_Stream_TypeDef* const m_burst_stream{DMA2_Stream5};
+  TIM_TypeDef* const m_burst_timer{TIM1};
 };
 }  // namespace details
 
 class Transmitter : public pv::Singleton<Transmitter> {
   static constexpr std::size_t MAX_BLOCK_LENGTH{BlockHeader::MAX_LENGTH};
 
-  static constexpr std::size_t DATA_SIZE{lcd::Panel::PIXEL_COUNT *
-                                         sizeof(bmp::Bgr888)};
-  static constexpr std::size_t BLOCKS_COUNT{DATA_SIZE /
-                                            BlockHeader::MAX_LENGTH};
-
   static constexpr std::uint8_t INTERRUPT_PRIORITY{12};
+  // Upper bounds, the actual delays adapt to the peer
   static constexpr std::uint16_t PASS_DELAY{100},
       RETRY_DELAY{std::numeric_limits<std::uint16_t>::max()};
+  // Limited by the peer sampling the data lines on RTS
+  static constexpr std::uint32_t BURST_RATE{1'000'000};
+  // A v2 data block is kept for a NAK after it has been sent for as long as
+  // the return path may take to deliver one, see SetReturnLatency(), plus
+  // the peer noticing the damage and the main loop picking the NAK up
+  static constexpr systick::milliseconds_t NAK_MARGIN{4};
 
   template <class Ty>
   using serialized_t =
       decltype(std::declval<const Serializable<Ty>&>().Serialize());
 
-  using serialized_header_t = serialized_t<BlockHeader>;
   using serialized_command_t = serialized_t<cmd::Command>;
 
  public:
-  static constexpr std::size_t QUEUE_DEPTH{
-      DATA_SIZE + BLOCKS_COUNT * sizeof(serialized_header_t)};
+  // In blocks, a few rows of the image at most
+  static constexpr std::size_t QUEUE_DEPTH{64};
+
+  using Statistics = details::ParallelPort<QUEUE_DEPTH>::Statistics;
+  using Mode = details::ParallelPort<QUEUE_DEPTH>::Mode;
+  using ticket_t = details::ParallelPort<QUEUE_DEPTH>::ticket_t;
+  using ResendStatus = details::ParallelPort<QUEUE_DEPTH>::ResendStatus;
+
+  // v1 blocks are up to 64 bytes long and unchecked, v2 data blocks carry
+  // a sequence id and a CRC and are resent on a NAK. Commands are always
+  // sent as v1 blocks.
+  enum class Protocol { V1, V2 };
 
  public:
   static Transmitter& GetInstance() noexcept;
 
-  void SendData(const std::byte* buffer, std::size_t bytes_count);
-
+  // The buffer isn't copied and must stay intact until the ticket is
+  // released. Nothing is queued if there is no room for the whole buffer.
+  [[nodiscard]] std::optional<ticket_t> SendData(
+      const std::byte* buffer,
+      std::size_t bytes_count) noexcept;
+  [[nodiscard]] bool IsReleased(ticket_t ticket) const noexcept;
+  // Same as SendData, but a row of BGR888 pixels is packed in place by the
+  // row codec when it's enabled and the protocol is v2. The buffer is only
+  // modified once the row is queued. Rows sent this way are referred to by
+  // the next one until the reference is reset by SendData(), a resend or
+  // BeginFrame().
+  [[nodiscard]] std::optional<ticket_t> SendRow(
+      std::byte* buffer,
+      std::size_t bytes_count) noexcept;
+
+  // Both sides must support v2, see cmd::Command::Type::ProtocolV2
+  void SetProtocol(Protocol protocol) noexcept;
+  [[nodiscard]] Protocol GetProtocol() const noexcept;
+  // Both sides must support it, see cmd::Command::Type::RowCodec
+  void SetRowCodec(bool enabled) noexcept;
+  // The first row of a frame isn't coded against the previous frame
+  void BeginFrame() noexcept;
+  // Expired if the block is too old to be sent again, the peer is told to
+  // skip it then. NoRoom if neither fits the queue.
+  [[nodiscard]] ResendStatus Resend(std::uint16_t sequence) noexcept;
+  // Sizes the NAK window, see io::Receiver::GetNakLatency()
+  void SetReturnLatency(systick::microseconds_t latency) noexcept;
+
+  // Commands are copied and go ahead of the queued data, waits for room
   void SendCommand(cmd::Command* command, std::size_t count);
 
+  // Everything queued has been taken by the peer
+  [[nodiscard]] bool IsIdle() const noexcept;
+  [[nodiscard]] const Statistics& GetStatistics() const noexcept;
+
+  // Both sides must agree on the mode, see io::BurstNegotiator
+  [[nodiscard]] bool SetMode(Mode mode) noexcept;
+  [[nodiscard]] Mode GetMode() const noexcept;
+
   template <
       class... Commands,
       std::enable_if_t<(sizeof...(Commands) > 0) &&
@@ -203,33 +670,45 @@ class Transmitter : public pv::Singleton<Transmitter> {
                                std::is_convertible<Commands, cmd::Command>...>,
                        int> = 0>
   void SendCommand(Commands... commands) {
-    if constexpr (sizeof...(Commands) == 1) {
-      const BlockHeader header{BlockHeader::Category::Command, 1};
-      m_port.Transfer(header, commands...);
-    } else {
-      std::array storage{static_cast<cmd::Command>(commands)...};
-      SendCommand(std::data(storage), std::size(storage));
-    }
+    std::array storage{static_cast<cmd::Command>(commands)...};
+    SendCommand(std::data(storage), std::size(storage));
   }
 
  private:
   friend void OnOverwrite() noexcept;
   friend void OnClearToSend() noexcept;
   friend void OnReadyToSend() noexcept;
+  friend void OnBurstError() noexcept;
   friend Singleton;
 
   Transmitter() = default;
-  void send_chunk(BlockHeader::Category category,
-                  const std::byte* buffer,
-                  std::size_t bytes_count);
 
-  template <class Ty>
-  static constexpr std::size_t calc_chunk_size() noexcept {
-    return MAX_BLOCK_LENGTH - MAX_BLOCK_LENGTH % sizeof(Ty);
+  std::optional<ticket_t> push_data(const std::byte* buffer,
+                                    std::size_t bytes_count) noexcept;
+
+  static details::Block make_block(BlockHeader::Category category,
+                                   const std::byte* buffer,
+                                   std::size_t bytes_count) noexcept;
+  static details::Block make_extended_block(const std::byte* buffer,
+                                            std::size_t bytes_count,
+                                            std::uint16_t sequence,
+                                            bool coded = false) noexcept;
+  static details::Block make_control_block(ExtendedHeader::Control control,
+                                           std::uint16_t sequence) noexcept;
+
+  static constexpr systick::milliseconds_t to_nak_window(
+      systick::microseconds_t latency) noexcept {
+    return (latency + 999) / 1000 + NAK_MARGIN;
   }
 
  private:
-  details::ParallelPort<QUEUE_DEPTH> m_port{{PASS_DELAY, RETRY_DELAY},
-                                            INTERRUPT_PRIORITY};
+  details::ParallelPort<QUEUE_DEPTH> m_port{
+      {PASS_DELAY, RETRY_DELAY, BURST_RATE,
+       to_nak_window(Receiver::GetNakLatency(Receiver::DEFAULT_SPEED_IDX))},
+      INTERRUPT_PRIORITY};
+  Protocol m_protocol{Protocol::V1};
+  std::uint16_t m_sequence{0};
+  RowCodec m_codec;
+  bool m_codec_enabled{false};
 };
 }  // namespace io
\ No newline at end of file
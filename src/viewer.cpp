@@ -1,11 +1,16 @@
 #include "viewer.hpp"
 
+#include <display/color.hpp>
 #include <display/display.hpp>
+#include <gallery/frame_cache.hpp>
 #include <tools/break_on.hpp>
+#include <tools/meta.hpp>
 #include <transceiver/command.hpp>
+#include <transceiver/negotiation.hpp>
 #include <transceiver/request_parser.hpp>
 #include <transceiver/transmitter.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <utility>
@@ -21,12 +26,16 @@ int main() {
         pv::CountFiles(pv::IMAGE_ROOT, [](const fs::DirectoryEntry& entry) {
           return pv::IsSupportedImageFile(entry);
         })};
-    BREAK_ON_FALSE(image_count > 0);
+    const size_t animation_count{
+        pv::CountFiles(pv::IMAGE_ROOT, [](const fs::DirectoryEntry& entry) {
+          return pv::IsSupportedAnimationFile(entry);
+        })};
+    BREAK_ON_FALSE(image_count > 0 || animation_count > 0);
 
     fs::CyclicDirectoryIterator dir_it{pv::IMAGE_ROOT};
     BREAK_ON_FALSE(dir_it != fs::CyclicDirectoryIterator{});
 
-    return pv::EventLoop(move(dir_it));
+    return pv::EventLoop(move(dir_it), image_count);
 
   } while (false);
 
@@ -34,66 +43,154 @@ int main() {
 }
 
 namespace pv {
-int EventLoop(fs::CyclicDirectoryIterator dir_it) noexcept {
+int EventLoop(fs::CyclicDirectoryIterator dir_it, size_t image_count) noexcept {
   pv::RequestParser<pv::COMMAND_QUEUE_SIZE, pv::PIXEL_QUEUE_SIZE> parser;
   ListenerGuard listener_guard{parser, io::Receiver::GetInstance()};
 
   auto& cmd_queue{parser.GetCommands()};
   auto& pixel_queue{parser.GetData()};
+  auto& nak_queue{parser.GetNaks()};
+  auto& reply_queue{parser.GetReplies()};
 
   auto& transmitter{io::Transmitter::GetInstance()};
   auto& command_manager{cmd::CommandManager::GetInstance()};
 
+  io::LinkSetup link_setup{
+      io::Receiver::GetInstance(),
+      {LINK_NEGOTIATION, BURST_NEGOTIATION, PROTOCOL_V2, ROW_CODEC,
+       LINK_TEST_TIMEOUT}};
+
   DisplayGuard display{pv::Display::GetInstance()};
+  display.SetColorFormat(COLOR_FORMAT);
   display.Activate();
 
-  optional<Image> image;
-  optional<ImageSender> image_sender;
+  Slideshow slideshow{move(dir_it), image_count, display, transmitter};
+  OutgoingRows outgoing_rows;
+  optional<uint16_t> pending_nak;
   PixelPart current_pixel;
 
   for (;;) {
     command_manager.Flush(transmitter);
+    // A NAK waits for room in the queue until the next iteration. Blocks
+    // past the NAK window can't be sent again, the peer is told to skip
+    // them and repeats the row before.
+    while (pending_nak || (pending_nak = nak_queue.consume())) {
+      if (transmitter.Resend(*pending_nak) ==
+          io::Transmitter::ResendStatus::NoRoom) {
+        break;
+      }
+      pending_nak.reset();
+    }
+    while (const auto reply = reply_queue.consume()) {
+      link_setup.OnReply(transmitter, *reply);
+    }
 
-    if (!display.IsFilled() && image.has_value()) {
-      for (size_t idx = 0; idx < PIXEL_TIMESLICE; ++idx) {
-        if (!current_pixel.Update(pixel_queue)) {
-          break;
-        }
-        display.Draw(move(current_pixel).Get());
-        display.NotifyFillPixel();
+    // Commands wait in the queue until the link is settled
+    if (link_setup.Step(transmitter, pixel_queue) ==
+        io::LinkSetup::Status::InProgress) {
+      continue;
+    }
+
+    auto* presenter{slideshow.GetPresenter()};
+    const auto status{presenter ? presenter->Step(display)
+                                : IPresenter::Status::Completed};
+    if (status == IPresenter::Status::IoError) {
+      return EXIT_FAILURE;
+    }
+    if (status == IPresenter::Status::InProgress) {
+      array<bmp::Rgb666, PIXEL_TIMESLICE> span;
+      const size_t span_limit{min(size(span), display.GetPixelsRemaining())};
+      size_t span_size{0};
+      while (span_size < span_limit && current_pixel.Update(pixel_queue)) {
+        span[span_size++] = move(current_pixel).Get();
+      }
+      if (span_size > 0) {
+        presenter->Collect(data(span), span_size, display);
       }
     } else {
+      slideshow.NotifyPresented();
       bool cmd_success{true};
       for (size_t idx = 0; idx < COMMAND_TIMESLICE; ++idx) {
         const auto command{cmd_queue.consume()};
         if (!command) {
           break;
         }
-        command_manager.Execute(*command, [&](cmd::NextPictureTag) {
-          if (FindNextFile(dir_it, [&image](const fs::DirectoryEntry& entry) {
-                image = TryOpenImageFile(entry);
-                return image.has_value();
-              }) == fs::CyclicDirectoryIterator{}) {
-            cmd_success = false;
-          } else {
-            display.Refresh();
-            image_sender.emplace(*image);
-          }
-        });
+        command_manager.Execute(
+            *command, meta::Overloaded{
+                          [&](cmd::NextPictureTag) {
+                            cmd_success = slideshow.ShowNext();
+                          },
+                          [&](cmd::ThumbnailGridTag) {
+                            cmd_success = slideshow.ToggleGrid();
+                          },
+                          [&](cmd::LocalRenderingTag) {
+                            slideshow.SwitchRenderMode();
+                          },
+                          [&](cmd::OverlayTag) {
+                            cmd_success = slideshow.ToggleOverlay();
+                          }});
       }
       if (!cmd_success) {
         return EXIT_FAILURE;
       }
     }
 
-    if (image_sender.has_value() &&
-        image_sender->Transmit(transmitter) == ImageSender::Status::IoError) {
+    // A command may have replaced the presenter
+    if (presenter = slideshow.GetPresenter();
+        presenter && presenter->Transmit(transmitter, outgoing_rows) ==
+                         IPresenter::Status::IoError) {
       return EXIT_FAILURE;
     }
   }
   return EXIT_SUCCESS;
 }
 
+RenderMode NextRenderMode(RenderMode mode) noexcept {
+  switch (mode) {
+    case RenderMode::Peer:
+      return RenderMode::Standalone;
+    case RenderMode::Standalone:
+      return RenderMode::Hybrid;
+    case RenderMode::Hybrid:
+      return RenderMode::Progressive;
+    case RenderMode::Progressive:
+      break;
+  }
+  return RenderMode::Peer;
+}
+
+InterlacedRow GetInterlacedRow(size_t idx, size_t rows_count) noexcept {
+  for (const auto& pass : INTERLACE_PASSES) {
+    const size_t pass_rows{
+        pass.first < rows_count
+            ? (rows_count - pass.first + pass.step - 1) / pass.step
+            : 0};
+    if (idx < pass_rows) {
+      const size_t row{pass.first + idx * pass.step};
+      // The gap below a row is closed by the first pass placed into it
+      const size_t span{pass.first ? pass.first : pass.step};
+      return {row, min(span, rows_count - row)};
+    }
+    idx -= pass_rows;
+  }
+  return {idx, 1};  // the passes cover all the rows
+}
+
+void FormatOverlayText(osd::text_t& text,
+                       const char* name,
+                       size_t idx,
+                       size_t count) noexcept {
+  array<char, osd::MAX_CHARS + 1> index;
+  const int index_length{snprintf(data(index), size(index), "%u/%u",
+                                  static_cast<unsigned>(idx),
+                                  static_cast<unsigned>(count))};
+  // The name is cut or padded to leave a space before the index
+  const int name_width{
+      max(static_cast<int>(osd::MAX_CHARS) - index_length - 1, 0)};
+  snprintf(data(text), size(text), "%-*.*s %s", name_width, name_width, name,
+           data(index));
+}
+
 optional<Image> TryOpenImageFile(const fs::DirectoryEntry& entry) noexcept {
   do {
     BREAK_ON_TRUE(strcmp(entry.Extension(), pv::IMAGE_EXTENSION));
@@ -118,7 +215,35 @@ bool IsSupportedImageFile(const fs::DirectoryEntry& entry) noexcept {
   return TryOpenImageFile(entry).has_value();
 }
 
-DisplayGuard::DisplayGuard(Display& display) noexcept : m_display{display} {}
+optional<Animation> TryOpenAnimationFile(
+    const fs::DirectoryEntry& entry) noexcept {
+  do {
+    BREAK_ON_TRUE(strcmp(entry.Extension(), pv::ANIMATION_EXTENSION));
+
+    fs::File file{entry.Path(), FA_READ | FA_OPEN_EXISTING};
+    BREAK_ON_FALSE(file);
+
+    const optional container{anim::Animation::FromFile(file)};
+    BREAK_ON_FALSE(container.has_value());
+
+    BREAK_ON_FALSE(container->GetWidth() == lcd::Panel::PIXEL_HORIZONTAL);
+    BREAK_ON_FALSE(container->GetHeight() == lcd::Panel::PIXEL_VERTICAL);
+
+    return Animation{move(file), *container};
+
+  } while (false);
+
+  return nullopt;
+}
+
+bool IsSupportedAnimationFile(const fs::DirectoryEntry& entry) noexcept {
+  return TryOpenAnimationFile(entry).has_value();
+}
+
+DisplayGuard::DisplayGuard(Display& display) noexcept
+    : m_display{display}, m_vsync{lcd::Vsync::GetInstance()} {
+  m_dirty.Mark(Rect::Screen());  // GRAM content is undefined after reset
+}
 
 void DisplayGuard::Activate() noexcept {
   if (!m_active) {
@@ -127,21 +252,115 @@ void DisplayGuard::Activate() noexcept {
   }
 }
 
+void DisplayGuard::SetColorFormat(ColorFormat format) noexcept {
+  m_display.SetColorFormat(format);
+  m_dirty.Mark(Rect::Screen());
+}
+
+void DisplayGuard::SetOrientation(lcd::Orientation orientation) noexcept {
+  if (m_display.GetOrientation() != orientation) {
+    m_display.SetOrientation(orientation);
+    // The areas were marked in the previous coordinates
+    m_dirty.Mark(Rect::Screen());
+  }
+}
+
 void DisplayGuard::Refresh() noexcept {
-  m_display.Refresh();
+  const auto screen{Rect::Screen()};
+  SetWindow(screen.x0, screen.y0, screen.x1, screen.y1);
+}
+
+void DisplayGuard::SetWindow(uint16_t x0,
+                             uint16_t y0,
+                             uint16_t x1,
+                             uint16_t y1) noexcept {
+  const Rect window{x0, y0, x1, y1};
+  pace(window);
+  m_display.SetWindow(window);
+  m_dirty.Mark(window);
   m_pixels_filled = 0;
+  m_pixels_expected = window.GetArea();
+  m_window_opened_at = systick::Clock::GetInstance().NowUs();
+}
+
+void DisplayGuard::MoveWindow(uint16_t x0,
+                              uint16_t y0,
+                              uint16_t x1,
+                              uint16_t y1) noexcept {
+  const Rect window{x0, y0, x1, y1};
+  m_display.SetWindow(window);
+  m_dirty.Mark(window);
+}
+
+void DisplayGuard::Clear() noexcept {
+  for (const auto& area : m_dirty) {
+    m_display.Fill(area, bmp::Rgb666{});
+  }
+  m_dirty.Reset();
+  m_pixels_filled = m_pixels_expected = 0;
+}
+
+void DisplayGuard::DrawSpan(const bmp::Rgb666* pixels, size_t count) noexcept {
+  m_display.DrawSpan(pixels, count);
+  on_filled(count);
 }
 
-void DisplayGuard::Draw(bmp::Rgb666 pixel) noexcept {
-  m_display.Draw(pixel);
+void DisplayGuard::DrawSpan(const bmp::Rgb565* pixels, size_t count) noexcept {
+  m_display.DrawSpan(pixels, count);
+  on_filled(count);
 }
 
-void DisplayGuard::NotifyFillPixel() noexcept {
-  ++m_pixels_filled;
+void DisplayGuard::DrawAsync(const bmp::Rgb666* pixels,
+                             size_t count) noexcept {
+  m_display.DrawAsync(pixels, count);
+  on_filled(count);
+}
+
+void DisplayGuard::DrawAsync(const bmp::Rgb565* pixels,
+                             size_t count) noexcept {
+  m_display.DrawAsync(pixels, count);
+  on_filled(count);
+}
+
+void DisplayGuard::DrawPreview(const bmp::Rgb666* pixels,
+                               size_t count) noexcept {
+  m_display.DrawSpan(pixels, count);
+}
+
+void DisplayGuard::NotifyFillPixels(size_t count) noexcept {
+  on_filled(count);
 }
 
 bool DisplayGuard::IsFilled() noexcept {
-  return m_pixels_filled == lcd::Panel::PIXEL_COUNT;
+  return m_pixels_filled == m_pixels_expected;
+}
+
+size_t DisplayGuard::GetPixelsRemaining() const noexcept {
+  return m_pixels_expected - m_pixels_filled;
+}
+
+void DisplayGuard::pace(const Rect& window) const noexcept {
+  if constexpr (VSYNC_PACING) {
+    // The panel scans GRAM lines, window rows follow them only in order
+    if (!m_display.GetOrientation().KeepsLineOrder()) {
+      return;
+    }
+    const uint64_t duration_ns{static_cast<uint64_t>(window.GetArea()) *
+                               m_ns_per_pixel};
+    m_vsync.Pace(window.y0, window.y1,
+                 static_cast<systick::microseconds_t>(duration_ns / 1000));
+  }
+}
+
+void DisplayGuard::on_filled(size_t count) noexcept {
+  m_pixels_filled += count;
+  if (m_pixels_filled == m_pixels_expected && m_pixels_expected > 0) {
+    const auto elapsed{systick::Clock::GetInstance().NowUs() -
+                       m_window_opened_at};
+    const auto sample{static_cast<uint32_t>(
+        static_cast<uint64_t>(elapsed) * 1000 / m_pixels_expected)};
+    m_ns_per_pixel = m_ns_per_pixel ? (m_ns_per_pixel + sample) / 2 : sample;
+  }
 }
 
 ListenerGuard::ListenerGuard(io::IListener& listener,
@@ -154,6 +373,27 @@ ListenerGuard::~ListenerGuard() noexcept {
   m_receiver.Listen(nullptr);
 }
 
+auto OutgoingRows::Acquire(const io::Transmitter& transmitter) noexcept
+    -> row_t* {
+  if (const auto& ticket = m_tickets[m_next];
+      ticket && !transmitter.IsReleased(*ticket)) {
+    return nullptr;
+  }
+  return addressof(m_rows[m_next]);
+}
+
+bool OutgoingRows::Send(io::Transmitter& transmitter,
+                        size_t bytes_count) noexcept {
+  const auto ticket{transmitter.SendRow(
+      reinterpret_cast<byte*>(data(m_rows[m_next])), bytes_count)};
+  if (!ticket) {
+    return false;
+  }
+  m_tickets[m_next] = ticket;
+  m_next = (m_next + 1) % size(m_rows);
+  return true;
+}
+
 PixelPart::PixelPart() noexcept {
   new (std::data(m_pixel)) pixel_t;
 }
@@ -169,36 +409,732 @@ auto PixelPart::Get() && noexcept -> pixel_t {
   return *as_pixel;
 }
 
-ImageSender::ImageSender(Image& image) noexcept : m_image{image} {
-  m_row.emplace();
-}
+ImageSender::ImageSender(Image& image,
+                         size_t first_row,
+                         size_t rows_count,
+                         RowOrder order) noexcept
+    : m_image{image},
+      m_first_row{first_row},
+      m_rows_count{rows_count},
+      m_order{order} {}
 
-auto ImageSender::Transmit(io::Transmitter& transmitter) noexcept -> Status {
-  if (m_rows_idx == lcd::Panel::PIXEL_VERTICAL) {
+auto ImageSender::Transmit(io::Transmitter& transmitter,
+                           OutgoingRows& rows) noexcept -> Status {
+  if (m_rows_idx == m_rows_count) {
     return Status::Completed;
   }
 
-  if (m_row) {
-    transmitter.SendData(reinterpret_cast<byte*>(data(*m_row)),
-                         sizeof(pixel_row_t));
-    ++m_rows_idx;
-    m_row.reset();
+  if (m_row_loaded) {
+    if (rows.Send(transmitter, sizeof(pixel_row_t))) {
+      ++m_rows_idx;
+      m_row_loaded = false;
+    }
     return Status::InProgress;
   }
 
+  if (auto* row = rows.Acquire(transmitter); row) {
+    if (!load_row(*row)) {
+      return Status::IoError;
+    }
+    m_row_loaded = true;
+  }
+  return Status::InProgress;
+}
+
+auto ImageSender::Render(converted_row_t& row) noexcept -> Status {
+  if (m_rows_idx == m_rows_count) {
+    return Status::Completed;
+  }
+  if (is_native()) {
+    native_row_t native_row;
+    if (!read_row(reinterpret_cast<byte*>(data(native_row)))) {
+      return Status::IoError;
+    }
+    transform(begin(native_row), end(native_row), begin(row),
+              [](bmp::Rgb565 pixel) { return color::ToRgb666(pixel); });
+  } else {
+    pixel_row_t source;
+    if (!load_row(source)) {
+      return Status::IoError;
+    }
+    color::ToRgb666(data(source), size(source), data(row));
+  }
+  ++m_rows_idx;
+  return Status::InProgress;
+}
+
+auto ImageSender::Render(native_row_t& row) noexcept -> Status {
+  if (m_rows_idx == m_rows_count) {
+    return Status::Completed;
+  }
+  if (is_native()) {
+    if (!read_row(reinterpret_cast<byte*>(data(row)))) {
+      return Status::IoError;
+    }
+  } else {
+    pixel_row_t source;
+    if (!load_row(source)) {
+      return Status::IoError;
+    }
+    color::ToRgb565(data(source), size(source), data(row));
+  }
+  ++m_rows_idx;
+  return Status::InProgress;
+}
+
+bool ImageSender::is_native() const noexcept {
+  return m_image.bitmap.GetPixelFormat() == bmp::PixelFormat::Rgb565;
+}
+
+bool ImageSender::load_row(pixel_row_t& row) noexcept {
+  if (is_native()) {
+    // The peer takes BGR888 only
+    native_row_t native_row;
+    if (!read_row(reinterpret_cast<byte*>(data(native_row)))) {
+      return false;
+    }
+    transform(begin(native_row), end(native_row), begin(row),
+              [](bmp::Rgb565 pixel) { return color::ToBgr888(pixel); });
+    return true;
+  }
+  return read_row(reinterpret_cast<byte*>(data(row)));
+}
+
+bool ImageSender::read_row(byte* to) noexcept {
   auto& [file, image]{m_image};
-  do {
-    BREAK_ON_FALSE(m_rows_idx > 0 || file.Seek(image.GetBitmapOffset()));
+  // The file may be shared with another sender, so the position is
+  // always restored
+  const size_t row_idx{
+      m_first_row + (m_order == RowOrder::Interlaced
+                         ? GetInterlacedRow(m_rows_idx, m_rows_count).row
+                         : m_rows_idx)};
+  const size_t row_size{image.GetRowSize()};
+  return file.Seek(static_cast<uint32_t>(image.GetBitmapOffset() +
+                                         row_idx * row_size)) &&
+         file.Read(to, static_cast<UINT>(row_size)) == row_size;
+}
 
-    BREAK_ON_FALSE(file.Read(reinterpret_cast<byte*>(data(m_row.emplace())),
-                             sizeof(pixel_row_t)) == sizeof(pixel_row_t));
+PeerSender::PeerSender(Image& image, gallery::cache_key_t key) noexcept
+    : m_sender{image} {
+  gallery::FrameCache::GetInstance().BeginRecord(key);
+}
 
-    reverse(begin(*m_row), end(*m_row));
+auto PeerSender::Step(DisplayGuard& display) noexcept -> Status {
+  if (!display.IsFilled()) {
     return Status::InProgress;
+  }
+  gallery::FrameCache::GetInstance().EndRecord();
+  return Status::Completed;
+}
 
-  } while (false);
+void PeerSender::Collect(const bmp::Rgb666* pixels,
+                         size_t count,
+                         DisplayGuard& display) noexcept {
+  auto& frame_cache{gallery::FrameCache::GetInstance()};
+  for (size_t idx = 0; idx < count; ++idx) {
+    frame_cache.Record(pixels[idx]);
+  }
+  display.DrawSpan(pixels, count);
+}
+
+auto PeerSender::Transmit(io::Transmitter& transmitter,
+                          OutgoingRows& rows) noexcept -> Status {
+  return m_sender.Transmit(transmitter, rows);
+}
+
+LocalSender::LocalSender(Image& image,
+                         gallery::cache_key_t key,
+                         bool slide) noexcept
+    : m_sender{image} {
+  gallery::FrameCache::GetInstance().BeginRecord(key);
+  if (slide) {
+    m_transition.emplace(Display::GetInstance(), SLIDE_TRANSITION_STEP);
+  }
+}
+
+auto LocalSender::Step(DisplayGuard& display) noexcept -> Status {
+  if (m_transition.has_value()) {
+    return slide(display);
+  }
+  if (display.IsFilled()) {
+    gallery::FrameCache::GetInstance().EndRecord();
+    return Status::Completed;
+  }
+  const auto status{COLOR_FORMAT == ColorFormat::Rgb565
+                        ? render_row(display, m_native_rows)
+                        : render_row(display, m_rows)};
+  return status == Status::IoError ? Status::IoError : Status::InProgress;
+}
+
+void LocalSender::Collect(const bmp::Rgb666*, size_t, DisplayGuard&) noexcept {
+  // Nothing is sent to the peer, late rows of a previous picture are dropped
+}
+
+auto LocalSender::Transmit(io::Transmitter&, OutgoingRows&) noexcept
+    -> Status {
+  return Status::Completed;
+}
+
+auto LocalSender::slide(DisplayGuard& display) noexcept -> Status {
+  // The transition pulls the rows of the picture by itself
+  const auto status{m_transition->Step([&](SlideTransition::row_t& row) {
+    if (m_sender.Render(row) != Status::InProgress) {
+      return false;
+    }
+    auto& frame_cache{gallery::FrameCache::GetInstance()};
+    for (const auto pixel : row) {
+      frame_cache.Record(pixel);
+    }
+    display.NotifyFillPixels(size(row));
+    return true;
+  })};
+  if (status == SlideTransition::Status::Failed) {
+    return Status::IoError;
+  }
+  if (status == SlideTransition::Status::Completed) {
+    m_transition.reset();
+  }
+  return Status::InProgress;
+}
+
+template <class Rows>
+auto LocalSender::render_row(DisplayGuard& display, Rows& rows) noexcept
+    -> Status {
+  auto& row{rows[m_rows_idx]};
+  const auto status{m_sender.Render(row)};
+  if (status == Status::InProgress) {
+    display.DrawAsync(data(row), size(row));
+    auto& frame_cache{gallery::FrameCache::GetInstance()};
+    for (const auto pixel : row) {
+      if constexpr (is_same_v<decltype(pixel), const bmp::Rgb565>) {
+        frame_cache.Record(color::ToRgb666(pixel));
+      } else {
+        frame_cache.Record(pixel);
+      }
+    }
+    m_rows_idx ^= 1;
+  }
+  return status;
+}
+
+SplitBalancer::SplitBalancer(size_t peer_rows) noexcept
+    : m_peer_rows{peer_rows} {}
+
+size_t SplitBalancer::GetPeerRows() const noexcept {
+  return m_peer_rows;
+}
+
+void SplitBalancer::Update(size_t peer_rows,
+                           systick::microseconds_t peer_elapsed,
+                           size_t local_rows,
+                           systick::microseconds_t local_elapsed) noexcept {
+  // Both paths finish at the same time if the rows are shared in proportion
+  // to their throughput: peer / (peer + local), where each one is measured
+  // as rows / elapsed
+  const uint64_t peer_weight{static_cast<uint64_t>(peer_rows) *
+                             max<systick::microseconds_t>(local_elapsed, 1)};
+  const uint64_t local_weight{static_cast<uint64_t>(local_rows) *
+                              max<systick::microseconds_t>(peer_elapsed, 1)};
+  const auto target{static_cast<size_t>(
+      lcd::Panel::PIXEL_VERTICAL * peer_weight / (peer_weight + local_weight))};
+
+  // Halfway to the target to smooth out a single slow frame
+  m_peer_rows = clamp<size_t>((m_peer_rows + target) / 2, HYBRID_MIN_ROWS,
+                              lcd::Panel::PIXEL_VERTICAL - HYBRID_MIN_ROWS);
+}
+
+SplitSender::SplitSender(Image& image, SplitBalancer& balancer) noexcept
+    : m_balancer{balancer},
+      m_peer_rows{balancer.GetPeerRows()},
+      m_local_rows{lcd::Panel::PIXEL_VERTICAL - m_peer_rows},
+      m_peer{image, 0, m_peer_rows},
+      m_local{image, m_peer_rows, m_local_rows},
+      m_started_at{systick::Clock::GetInstance().NowUs()} {}
+
+auto SplitSender::Transmit(io::Transmitter& transmitter,
+                           OutgoingRows& rows) noexcept -> Status {
+  return m_peer.Transmit(transmitter, rows);
+}
+
+auto SplitSender::Step(DisplayGuard& display) noexcept -> Status {
+  converted_row_t row;
+  const auto status{m_local.Render(row)};
+  if (status == Status::IoError) {
+    return status;
+  }
+  if (status == Status::InProgress) {
+    draw_row(display, m_peer_rows + m_local_rows_drawn, row);
+    if (++m_local_rows_drawn == m_local_rows) {
+      m_local_elapsed = get_elapsed();
+      update_balancer();
+    }
+  }
+  return display.IsFilled() ? Status::Completed : Status::InProgress;
+}
+
+void SplitSender::Collect(const bmp::Rgb666* pixels,
+                          size_t count,
+                          DisplayGuard& display) noexcept {
+  for (size_t idx = 0; idx < count; ++idx) {
+    m_peer_row[m_peer_pixels] = pixels[idx];
+    if (++m_peer_pixels < size(m_peer_row)) {
+      continue;
+    }
+    m_peer_pixels = 0;
+    draw_row(display, m_peer_rows_drawn, m_peer_row);
+    if (++m_peer_rows_drawn == m_peer_rows) {
+      m_peer_elapsed = get_elapsed();
+      update_balancer();
+    }
+  }
+}
+
+void SplitSender::draw_row(DisplayGuard& display,
+                           size_t row_idx,
+                           const converted_row_t& row) noexcept {
+  const auto y{static_cast<uint16_t>(row_idx)};
+  display.MoveWindow(0, y, lcd::Panel::PIXEL_HORIZONTAL - 1, y);
+  display.DrawSpan(data(row), size(row));
+}
+
+void SplitSender::update_balancer() noexcept {
+  if (m_peer_rows_drawn == m_peer_rows && m_local_rows_drawn == m_local_rows) {
+    m_balancer.Update(m_peer_rows, m_peer_elapsed, m_local_rows,
+                      m_local_elapsed);
+  }
+}
+
+systick::microseconds_t SplitSender::get_elapsed() const noexcept {
+  return systick::Clock::GetInstance().NowUs() - m_started_at;
+}
+
+ProgressiveSender::ProgressiveSender(Image& image) noexcept
+    : m_sender{image, 0, lcd::Panel::PIXEL_VERTICAL, RowOrder::Interlaced} {}
+
+auto ProgressiveSender::Transmit(io::Transmitter& transmitter,
+                                 OutgoingRows& rows) noexcept -> Status {
+  return m_sender.Transmit(transmitter, rows);
+}
+
+auto ProgressiveSender::Step(DisplayGuard& display) noexcept -> Status {
+  return display.IsFilled() ? Status::Completed : Status::InProgress;
+}
+
+void ProgressiveSender::Collect(const bmp::Rgb666* pixels,
+                                size_t count,
+                                DisplayGuard& display) noexcept {
+  for (size_t idx = 0; idx < count; ++idx) {
+    m_row[m_pixels] = pixels[idx];
+    if (++m_pixels == size(m_row)) {
+      m_pixels = 0;
+      draw_row(display);
+    }
+  }
+}
+
+void ProgressiveSender::draw_row(DisplayGuard& display) noexcept {
+  const auto [row_idx, span]{
+      GetInterlacedRow(m_rows_drawn++, lcd::Panel::PIXEL_VERTICAL)};
+  const size_t rows_count{PROGRESSIVE_FILL_GAPS ? span : 1};
+  display.MoveWindow(0, static_cast<uint16_t>(row_idx),
+                     lcd::Panel::PIXEL_HORIZONTAL - 1,
+                     static_cast<uint16_t>(row_idx + rows_count - 1));
+  display.DrawSpan(data(m_row), size(m_row));
+  for (size_t copy = 1; copy < rows_count; ++copy) {
+    display.DrawPreview(data(m_row), size(m_row));
+  }
+}
+
+void Overlay::Show(DisplayGuard& display, const char* text) noexcept {
+  const auto& label{osd::LabelCache::GetInstance().Get(text)};
+  set_band_window(display);
+  osd::row_t row;
+  for (size_t row_idx = osd::BAND_HEIGHT; row_idx-- > 0;) {
+    label.Render(row_idx, row);
+    display.DrawPreview(data(row), size(row));
+  }
+  m_shown = true;
+}
+
+bool Overlay::Hide(DisplayGuard& display, Image& image) noexcept {
+  ImageSender sender{image, 0, osd::BAND_HEIGHT};
+  ImageSender::converted_row_t row;
+  set_band_window(display);
+  auto status{sender.Render(row)};
+  for (; status == ImageSender::Status::InProgress;
+       status = sender.Render(row)) {
+    display.DrawPreview(data(row), size(row));
+  }
+  m_shown = false;
+  return status == ImageSender::Status::Completed;
+}
+
+void Overlay::Reset() noexcept {
+  m_shown = false;
+}
+
+bool Overlay::IsShown() const noexcept {
+  return m_shown;
+}
+
+void Overlay::set_band_window(DisplayGuard& display) noexcept {
+  // Image rows are bottom-up, so the band is written from its last row
+  display.MoveWindow(0, 0, lcd::Panel::PIXEL_HORIZONTAL - 1,
+                     osd::BAND_HEIGHT - 1);
+}
+
+ThumbnailSender::ThumbnailSender(fs::CyclicDirectoryIterator& dir_it,
+                                 size_t cells_count) noexcept
+    : m_dir_it{dir_it}, m_cells_count{cells_count} {}
+
+auto ThumbnailSender::Transmit(io::Transmitter& transmitter,
+                               OutgoingRows& rows) noexcept -> Status {
+  if (m_cells_sent == m_cells_count) {
+    return Status::Completed;
+  }
+  if (!m_thumbnail) {
+    return load_next_thumbnail() ? Status::InProgress : Status::IoError;
+  }
+
+  auto* row{rows.Acquire(transmitter)};
+  if (!row) {
+    return Status::InProgress;
+  }
+  const auto& source{(*m_thumbnail)[m_rows_idx]};
+  copy(begin(source), end(source), begin(*row));
+  if (!rows.Send(transmitter, sizeof(gallery::thumbnail_row_t))) {
+    return Status::InProgress;
+  }
+  if (++m_rows_idx == gallery::THUMBNAIL_SIDE) {
+    m_rows_idx = 0;
+    m_thumbnail = nullptr;
+    ++m_cells_sent;
+  }
+  return Status::InProgress;
+}
+
+auto ThumbnailSender::Step(DisplayGuard& display) noexcept -> Status {
+  if (!display.IsFilled()) {
+    return Status::InProgress;
+  }
+  if (m_cells_drawn == m_cells_count) {
+    return Status::Completed;
+  }
+  // Thumbnails are drawn in the default orientation, in which the panel
+  // shows GRAM rotated by 180 degrees, so cells are laid out from its end
+  // to make the first thumbnail appear in the top left corner
+  const size_t cell_idx{GRID_CELLS - ++m_cells_drawn};
+  const auto x{
+      static_cast<uint16_t>(cell_idx % GRID_COLUMNS * gallery::THUMBNAIL_SIDE)};
+  const auto y{
+      static_cast<uint16_t>(cell_idx / GRID_COLUMNS * gallery::THUMBNAIL_SIDE)};
+  display.SetWindow(x, y, x + gallery::THUMBNAIL_SIDE - 1,
+                    y + gallery::THUMBNAIL_SIDE - 1);
+  return Status::InProgress;
+}
+
+void ThumbnailSender::Collect(const bmp::Rgb666* pixels,
+                              size_t count,
+                              DisplayGuard& display) noexcept {
+  display.DrawSpan(pixels, count);
+}
+
+bool ThumbnailSender::load_next_thumbnail() noexcept {
+  optional<Image> image;
+  if (FindNextFile(m_dir_it, [&image](const fs::DirectoryEntry& entry) {
+        image = TryOpenImageFile(entry);
+        return image.has_value();
+      }) == fs::CyclicDirectoryIterator{}) {
+    return false;
+  }
+  auto& [file, bitmap]{*image};
+  auto& loader{gallery::ThumbnailLoader::GetInstance()};
+  m_thumbnail = loader.Load(m_dir_it->Path(), file, bitmap);
+  return m_thumbnail != nullptr;
+}
+
+AnimationSender::AnimationSender(Animation& animation,
+                                 uint16_t frame_rate) noexcept
+    : m_animation{animation},
+      m_frame_rate{frame_rate},
+      m_started_at{systick::Clock::GetInstance().Now()},
+      m_loop_started_at{m_started_at} {}
+
+auto AnimationSender::Transmit(io::Transmitter& transmitter,
+                               OutgoingRows& rows) noexcept -> Status {
+  bool success{true};
+  switch (m_state) {
+    case State::Idle:
+      if (m_frame_idx == m_animation.container.GetFramesCount()) {
+        restart();  // Playback is looped until the next picture is requested
+      }
+      if (get_loop_time() >= get_frame_start(m_frame_idx)) {
+        success = start_frame();
+        transmitter.BeginFrame();
+      }
+      break;
+    case State::Sending:
+      success = send_row(transmitter, rows);
+      break;
+    case State::Sent:
+      break;
+  }
+  return success ? Status::InProgress : Status::IoError;
+}
+
+auto AnimationSender::Step(DisplayGuard& display) noexcept -> Status {
+  if (!display.IsFilled()) {
+    return Status::InProgress;
+  }
+  if (!m_window_pending) {
+    return Status::Completed;
+  }
+  display.SetWindow(m_frame.x0, m_frame.y0, m_frame.x1, m_frame.y1);
+  m_window_pending = false;
+  return Status::InProgress;
+}
+
+void AnimationSender::Collect(const bmp::Rgb666* pixels,
+                              size_t count,
+                              DisplayGuard& display) noexcept {
+  display.DrawSpan(pixels, count);
+}
+
+void AnimationSender::NotifyPresented() noexcept {
+  if (m_state != State::Sent) {
+    return;
+  }
+  const auto now{systick::Clock::GetInstance().Now()};
+  const auto deadline{m_loop_started_at + get_frame_start(m_frame_idx + 1)};
+  if (const auto lateness = now - deadline;
+      static_cast<int32_t>(lateness) > 0) {
+    ++m_statistics.frames_late;
+    m_statistics.max_lateness = max(m_statistics.max_lateness, lateness);
+  }
+  ++m_statistics.frames_shown;
+  m_statistics.elapsed = now - m_started_at;
+
+  ++m_frame_idx;
+  m_frame_offset = m_next_frame_offset;
+  m_state = State::Idle;
+}
+
+auto AnimationSender::GetStatistics() const noexcept -> const Statistics& {
+  return m_statistics;
+}
+
+bool AnimationSender::start_frame() noexcept {
+  const auto& container{m_animation.container};
+  for (;;) {
+    const auto header{read_frame_header(m_frame_offset)};
+    if (!header) {
+      return false;
+    }
+    m_next_frame_offset = m_frame_offset +
+                          anim::Animation::FRAME_HEADER_RAW_SIZE +
+                          header->GetBitmapSize();
+
+    // Deltas depend on the previous frame, so a late frame may be dropped
+    // only if the next one is a key frame
+    const size_t next_idx{m_frame_idx + 1};
+    if (next_idx < container.GetFramesCount() &&
+        get_loop_time() >= get_frame_start(next_idx)) {
+      if (const auto next = read_frame_header(m_next_frame_offset);
+          next && container.IsKeyFrame(*next)) {
+        ++m_statistics.frames_dropped;
+        m_frame_idx = next_idx;
+        m_frame_offset = m_next_frame_offset;
+        continue;
+      }
+    }
+
+    if (!m_animation.file.Seek(m_frame_offset +
+                               anim::Animation::FRAME_HEADER_RAW_SIZE)) {
+      return false;
+    }
+    m_frame = *header;
+    m_rows_idx = 0;
+    m_window_pending = true;
+    m_state = State::Sending;
+    return true;
+  }
+}
+
+bool AnimationSender::send_row(io::Transmitter& transmitter,
+                               OutgoingRows& rows) noexcept {
+  const size_t row_size{m_frame.GetWidth() * sizeof(pixel_t)};
+  if (!m_row_loaded) {
+    auto* row{rows.Acquire(transmitter)};
+    if (!row) {
+      return true;
+    }
+    if (m_animation.file.Read(reinterpret_cast<byte*>(data(*row)),
+                              static_cast<UINT>(row_size)) != row_size) {
+      return false;
+    }
+    m_row_loaded = true;
+  }
+  if (!rows.Send(transmitter, row_size)) {
+    return true;
+  }
+  m_row_loaded = false;
+  if (++m_rows_idx == m_frame.GetHeight()) {
+    m_state = State::Sent;
+  }
+  return true;
+}
+
+void AnimationSender::restart() noexcept {
+  m_frame_idx = 0;
+  m_frame_offset = anim::Animation::HEADER_RAW_SIZE;
+  m_loop_started_at = systick::Clock::GetInstance().Now();
+}
+
+optional<anim::FrameHeader> AnimationSender::read_frame_header(
+    uint32_t offset) noexcept {
+  auto& file{m_animation.file};
+  if (!file.Seek(offset)) {
+    return nullopt;
+  }
+  const auto header{anim::Animation::ReadFrameHeader(file)};
+  if (!header || header->x1 >= lcd::Panel::PIXEL_HORIZONTAL ||
+      header->y1 >= lcd::Panel::PIXEL_VERTICAL) {
+    return nullopt;
+  }
+  return header;
+}
+
+systick::milliseconds_t AnimationSender::get_frame_start(
+    size_t frame_idx) const noexcept {
+  return static_cast<systick::milliseconds_t>(frame_idx * 1000 / m_frame_rate);
+}
+
+systick::milliseconds_t AnimationSender::get_loop_time() const noexcept {
+  return systick::Clock::GetInstance().Now() - m_loop_started_at;
+}
+
+Slideshow::Slideshow(fs::CyclicDirectoryIterator dir_it,
+                     size_t image_count,
+                     DisplayGuard& display,
+                     io::Transmitter& transmitter) noexcept
+    : m_dir_it{move(dir_it)},
+      m_image_count{image_count},
+      m_display{display},
+      m_transmitter{transmitter} {}
+
+IPresenter* Slideshow::GetPresenter() noexcept {
+  return m_presenter;
+}
+
+void Slideshow::NotifyPresented() noexcept {
+  if (m_overlay_enabled && m_image.has_value() && !m_overlay.IsShown()) {
+    m_overlay.Show(m_display, data(m_overlay_text));
+  }
+  if (m_presenter) {
+    m_presenter->NotifyPresented();
+  }
+}
+
+bool Slideshow::ShowNext() noexcept {
+  return m_grid_mode ? show_next_page() : show_next_picture();
+}
+
+bool Slideshow::ToggleGrid() noexcept {
+  // Animations have no thumbnails
+  if (m_image_count == 0) {
+    return true;
+  }
+  m_grid_mode = !m_grid_mode;
+  return ShowNext();
+}
+
+void Slideshow::SwitchRenderMode() noexcept {
+  m_render_mode = NextRenderMode(m_render_mode);
+}
+
+bool Slideshow::ToggleOverlay() noexcept {
+  m_overlay_enabled = !m_overlay_enabled;
+  if (!m_overlay_enabled && m_overlay.IsShown()) {
+    return m_overlay.Hide(m_display, *m_image);
+  }
+  return true;
+}
+
+bool Slideshow::show_next_picture() noexcept {
+  reset();
+  if (FindNextFile(m_dir_it, [this](const fs::DirectoryEntry& entry) {
+        m_image = TryOpenImageFile(entry);
+        m_animation =
+            m_image.has_value() ? nullopt : TryOpenAnimationFile(entry);
+        return m_image.has_value() || m_animation.has_value();
+      }) == fs::CyclicDirectoryIterator{}) {
+    return false;
+  }
+  if (m_animation.has_value()) {
+    const uint16_t frame_rate{ANIMATION_FRAME_RATE
+                                  ? ANIMATION_FRAME_RATE
+                                  : m_animation->container.GetFrameRate()};
+    m_display.SetOrientation(lcd::Orientation{});
+    present<AnimationSender>(*m_animation, frame_rate);
+    return true;
+  }
+  advance_picture(1);
+  FormatOverlayText(m_overlay_text, m_dir_it->Path(), m_picture_idx,
+                    m_image_count);
+  // Only a complete picture is slid out
+  const bool slide{SLIDE_TRANSITION_STEP > 0 &&
+                   IMAGE_ORIENTATION.KeepsLineOrder() &&
+                   m_render_mode == RenderMode::Standalone &&
+                   m_display.IsFilled()};
+  m_display.SetOrientation(IMAGE_ORIENTATION);
+  m_display.Refresh();
+  const auto key{gallery::MakeCacheKey(m_dir_it->Path())};
+  if (gallery::FrameCache::GetInstance().Replay(
+          key, [this](const bmp::Rgb666* pixels, size_t count) {
+            m_display.DrawSpan(pixels, count);
+          })) {
+    return true;
+  }
+  switch (m_render_mode) {
+    case RenderMode::Peer:
+      present<PeerSender>(*m_image, key);
+      break;
+    case RenderMode::Standalone:
+      present<LocalSender>(*m_image, key, slide);
+      break;
+    case RenderMode::Hybrid:
+      // Rows arrive out of order and can't be recorded
+      present<SplitSender>(*m_image, m_split_balancer);
+      break;
+    case RenderMode::Progressive:
+      present<ProgressiveSender>(*m_image);
+      break;
+  }
+  return true;
+}
+
+bool Slideshow::show_next_page() noexcept {
+  reset();
+  m_image.reset();
+  m_animation.reset();
+  const size_t cells_count{min(GRID_CELLS, m_image_count)};
+  m_display.SetOrientation(lcd::Orientation{});
+  if (cells_count < GRID_CELLS) {
+    m_display.Clear();
+  }
+  present<ThumbnailSender>(m_dir_it, cells_count);
+  advance_picture(cells_count);
+  return true;
+}
+
+void Slideshow::advance_picture(size_t count) noexcept {
+  m_picture_idx = (m_picture_idx + count - 1) % m_image_count + 1;
+}
 
-  m_row.reset();
-  return Status::IoError;
+void Slideshow::reset() noexcept {
+  m_overlay.Reset();
+  m_senders.emplace<monostate>();
+  m_presenter = nullptr;
+  m_transmitter.BeginFrame();
 }
-}  // namespace pv
\ No newline at end of file
+}  // namespace pv
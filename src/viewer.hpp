@@ -1,7 +1,14 @@
 #pragma once
 #include <display/display.hpp>
+#include <display/osd.hpp>
+#include <display/transition.hpp>
+#include <display/vsync.hpp>
+#include <filesystem/animation.hpp>
 #include <filesystem/bmp.hpp>
 #include <filesystem/file.hpp>
+#include <gallery/cache_key.hpp>
+#include <gallery/thumbnail.hpp>
+#include <platform/systick.hpp>
 #include <transceiver/receiver.hpp>
 #include <transceiver/transmitter.hpp>
 
@@ -11,10 +18,73 @@
 #include <memory>
 #include <optional>
 #include <type_traits>
+#include <utility>
+#include <variant>
 
 namespace pv {
 inline constexpr auto* IMAGE_ROOT{R"(\)"};
 inline constexpr auto* IMAGE_EXTENSION{"bmp"};
+inline constexpr auto* ANIMATION_EXTENSION{"pva"};
+
+// Standalone mode converts still images on-board and skips the peer,
+// hybrid mode shares the rows of every still image between both,
+// progressive mode has the peer convert the rows in interlaced order
+enum class RenderMode { Peer, Standalone, Hybrid, Progressive };
+inline constexpr RenderMode DEFAULT_RENDER_MODE{RenderMode::Peer};
+
+// RGB565 halves the bus writes per pixel, 16-bit bitmaps are drawn as is
+inline constexpr ColorFormat COLOR_FORMAT{ColorFormat::Rgb666};
+
+// BMP rows are bottom-up, so still images are written as they are stored
+// with mirrored columns instead of reversing every row. Thumbnails and
+// animations are kept in GRAM order and use the default orientation.
+inline constexpr lcd::Orientation IMAGE_ORIENTATION{lcd::Rotation::Deg0,
+                                                    true};
+
+// Rows revealed per step when standalone mode slides the next picture in,
+// zero draws it in place. Needs an orientation keeping the line order.
+inline constexpr std::uint16_t SLIDE_TRANSITION_STEP{8};
+
+// Initial share of the peer in hybrid mode, rebalanced after every image
+inline constexpr std::uint16_t HYBRID_PEER_ROWS{lcd::Panel::PIXEL_VERTICAL /
+                                                2};
+// Both paths keep some rows to have their throughput measured
+inline constexpr std::uint16_t HYBRID_MIN_ROWS{1};
+
+// Progressive mode sends every 8th row first, then the rows in between.
+// A row covers the gap below it until the finer passes arrive.
+struct InterlacePass {
+  std::uint8_t first;
+  std::uint8_t step;
+};
+inline constexpr std::array<InterlacePass, 4> INTERLACE_PASSES{
+    {{0, 8}, {4, 8}, {2, 4}, {1, 2}}};
+// Duplicates the rows of the coarse passes instead of leaving the gaps
+// with the previous picture
+inline constexpr bool PROGRESSIVE_FILL_GAPS{true};
+
+// The file name and the picture index over the bottom of still images,
+// toggled by the overlay command
+inline constexpr bool OVERLAY_ENABLED{true};
+
+// Overrides the frame rate stored in animation containers if non-zero
+inline constexpr std::uint16_t ANIMATION_FRAME_RATE{0};
+
+// The return path starts at the lowest rate and is raised while the peer
+// delivers the test pattern intact
+inline constexpr bool LINK_NEGOTIATION{true};
+inline constexpr systick::milliseconds_t LINK_TEST_TIMEOUT{50};
+
+// The parallel port is switched to DMA bursts if the peer echoes the test
+// pattern sent that way
+inline constexpr bool BURST_NEGOTIATION{true};
+
+// Data blocks switch to the v2 format (sequence ids, CRC, NAKs) once the
+// peer echoes the request, older peers keep getting v1 blocks
+inline constexpr bool PROTOCOL_V2{true};
+// Rows in v2 data blocks are packed (run-length over left/up deltas) if the
+// peer echoes the request as well
+inline constexpr bool ROW_CODEC{true};
 
 inline constexpr std::size_t COMMAND_QUEUE_SIZE{64};
 inline constexpr std::size_t COMMAND_TIMESLICE{8};
@@ -23,16 +93,60 @@ inline constexpr std::size_t PIXEL_QUEUE_SIZE{lcd::Panel::PIXEL_HORIZONTAL *
                                               sizeof(bmp::Rgb666)};
 inline constexpr std::size_t PIXEL_TIMESLICE{lcd::Panel::PIXEL_HORIZONTAL};
 
+// Rows read for the peer stay in place until the transmitter releases them,
+// which takes the NAK window in the v2 protocol
+inline constexpr std::size_t OUTGOING_ROWS{8};
+
+inline constexpr std::uint16_t GRID_COLUMNS{lcd::Panel::PIXEL_HORIZONTAL /
+                                            gallery::THUMBNAIL_SIDE};
+inline constexpr std::uint16_t GRID_ROWS{lcd::Panel::PIXEL_VERTICAL /
+                                         gallery::THUMBNAIL_SIDE};
+inline constexpr std::size_t GRID_CELLS{GRID_COLUMNS * GRID_ROWS};
+
+// Areas drawn since the last clear, only those are blanked by Clear()
+inline constexpr std::size_t DIRTY_RECTS_CAPACITY{4};
+
+// Windows are started when the panel scan can't cross them (LCD_TE)
+inline constexpr bool VSYNC_PACING{true};
+
 struct Image {
   fs::File file;
   bmp::Image bitmap;
 };
 
-int EventLoop(fs::CyclicDirectoryIterator dir_it) noexcept;
+struct Animation {
+  fs::File file;
+  anim::Animation container;
+};
+
+int EventLoop(fs::CyclicDirectoryIterator dir_it,
+              std::size_t image_count) noexcept;
+
+RenderMode NextRenderMode(RenderMode mode) noexcept;
+
+enum class RowOrder { Sequential, Interlaced };
+
+struct InterlacedRow {
+  std::size_t row;
+  std::size_t span;  // rows to cover until the next passes fill them
+};
+
+InterlacedRow GetInterlacedRow(std::size_t idx,
+                               std::size_t rows_count) noexcept;
+
+// "<name>  <idx>/<count>" with the index aligned to the right edge
+void FormatOverlayText(osd::text_t& text,
+                       const char* name,
+                       std::size_t idx,
+                       std::size_t count) noexcept;
 
 std::optional<Image> TryOpenImageFile(const fs::DirectoryEntry& entry) noexcept;
 bool IsSupportedImageFile(const fs::DirectoryEntry& entry) noexcept;
 
+std::optional<Animation> TryOpenAnimationFile(
+    const fs::DirectoryEntry& entry) noexcept;
+bool IsSupportedAnimationFile(const fs::DirectoryEntry& entry) noexcept;
+
 template <class UnaryPredicate>
 size_t CountFiles(const char* directory, UnaryPredicate pred) noexcept {
   size_t count{0};
@@ -64,16 +178,44 @@ class DisplayGuard {
   explicit DisplayGuard(Display& display) noexcept;
 
   void Activate() noexcept;
+  void SetColorFormat(ColorFormat format) noexcept;
+  void SetOrientation(lcd::Orientation orientation) noexcept;
   void Refresh() noexcept;
-  void Draw(bmp::Rgb666 pixel) noexcept;
+  void SetWindow(std::uint16_t x0,
+                 std::uint16_t y0,
+                 std::uint16_t x1,
+                 std::uint16_t y1) noexcept;
+  // Unlike SetWindow(), keeps counting pixels towards the current frame
+  void MoveWindow(std::uint16_t x0,
+                  std::uint16_t y0,
+                  std::uint16_t x1,
+                  std::uint16_t y1) noexcept;
+  void Clear() noexcept;
+  // Counts the pixels itself, no NotifyFillPixels() is needed
+  void DrawSpan(const bmp::Rgb666* pixels, std::size_t count) noexcept;
+  void DrawSpan(const bmp::Rgb565* pixels, std::size_t count) noexcept;
+  void DrawAsync(const bmp::Rgb666* pixels, std::size_t count) noexcept;
+  void DrawAsync(const bmp::Rgb565* pixels, std::size_t count) noexcept;
+  // Pixels not counted towards the frame: placeholders and overlays
+  void DrawPreview(const bmp::Rgb666* pixels, std::size_t count) noexcept;
 
-  void NotifyFillPixel() noexcept;
+  void NotifyFillPixels(std::size_t count) noexcept;
   [[nodiscard]] bool IsFilled() noexcept;
+  [[nodiscard]] std::size_t GetPixelsRemaining() const noexcept;
+
+ private:
+  void pace(const Rect& window) const noexcept;
+  void on_filled(std::size_t count) noexcept;
 
  private:
   Display& m_display;
+  lcd::Vsync& m_vsync;
   bool m_active{false};
   std::size_t m_pixels_filled{};
+  std::size_t m_pixels_expected{lcd::Panel::PIXEL_COUNT};
+  DirtyRegion<DIRTY_RECTS_CAPACITY> m_dirty;
+  systick::microseconds_t m_window_opened_at{0};
+  std::uint32_t m_ns_per_pixel{0};  // Measured write rate
 };
 
 class ListenerGuard {
@@ -89,6 +231,26 @@ class ListenerGuard {
   io::Receiver& m_receiver;
 };
 
+// A ring of row buffers shared by the senders. The next row is handed out
+// once the transmitter has released it, so a sender that gets nothing
+// simply tries again on the next iteration.
+class OutgoingRows {
+ public:
+  using row_t = std::array<bmp::Bgr888, lcd::Panel::PIXEL_HORIZONTAL>;
+
+ public:
+  // The same row is returned until it's sent
+  [[nodiscard]] row_t* Acquire(const io::Transmitter& transmitter) noexcept;
+  // The row stays acquired if the queue is full
+  bool Send(io::Transmitter& transmitter, std::size_t bytes_count) noexcept;
+
+ private:
+  std::array<row_t, OUTGOING_ROWS> m_rows;
+  std::array<std::optional<io::Transmitter::ticket_t>, OUTGOING_ROWS>
+      m_tickets{};
+  std::size_t m_next{0};
+};
+
 class PixelPart {
   using pixel_t = bmp::Rgb666;
 
@@ -124,18 +286,387 @@ class ImageSender {
   using pixel_row_t = std::array<pixel_t, lcd::Panel::PIXEL_HORIZONTAL>;
 
  public:
-  ImageSender(Image& image) noexcept;
+  using converted_row_t =
+      std::array<bmp::Rgb666, lcd::Panel::PIXEL_HORIZONTAL>;
+  using native_row_t = std::array<bmp::Rgb565, lcd::Panel::PIXEL_HORIZONTAL>;
+
+ public:
+  ImageSender(Image& image,
+              std::size_t first_row = 0,
+              std::size_t rows_count = lcd::Panel::PIXEL_VERTICAL,
+              RowOrder order = RowOrder::Sequential) noexcept;
   ImageSender(const ImageSender&) = delete;
   ImageSender(ImageSender&&) = delete;
   ImageSender& operator=(const ImageSender&) = delete;
   ImageSender& operator=(ImageSender&&) = delete;
   ~ImageSender() = default;
 
-  Status Transmit(io::Transmitter& transmitter) noexcept;
+  Status Transmit(io::Transmitter& transmitter, OutgoingRows& rows) noexcept;
+  Status Render(converted_row_t& row) noexcept;
+  // 16-bit bitmaps are passed through without conversion
+  Status Render(native_row_t& row) noexcept;
+
+ private:
+  [[nodiscard]] bool is_native() const noexcept;
+  bool load_row(pixel_row_t& row) noexcept;
+  bool read_row(std::byte* to) noexcept;
 
  private:
   Image& m_image;
-  std::optional<pixel_row_t> m_row;
+  std::size_t m_first_row;
+  std::size_t m_rows_count;
+  RowOrder m_order;
+  bool m_row_loaded{false};  // waits for room in the transmitter queue
+  std::size_t m_rows_idx{0};
+};
+
+// A picture on its way to the screen. The event loop hands it the pixels
+// returned by the peer until it completes, then executes the commands.
+struct IPresenter {
+  using Status = ImageSender::Status;
+
+  IPresenter() = default;
+  IPresenter(const IPresenter&) = default;
+  IPresenter(IPresenter&&) = default;
+  IPresenter& operator=(const IPresenter&) = default;
+  IPresenter& operator=(IPresenter&&) = default;
+  virtual ~IPresenter() = default;
+
+  // Draws what doesn't come from the peer, Completed once the picture is
+  // on the screen
+  virtual Status Step(DisplayGuard& display) noexcept = 0;
+  // Pixels converted by the peer, up to the pixels the window still takes
+  virtual void Collect(const bmp::Rgb666* pixels,
+                       std::size_t count,
+                       DisplayGuard& display) noexcept = 0;
+  // Feeds the peer
+  virtual Status Transmit(io::Transmitter& transmitter,
+                          OutgoingRows& rows) noexcept = 0;
+
+  // The picture has stayed on the screen for a whole iteration
+  virtual void NotifyPresented() noexcept {}
+};
+
+// The peer converts the rows of a still image in order, they are recorded
+// into the frame cache on the way to the screen
+class PeerSender final : public IPresenter {
+ public:
+  PeerSender(Image& image, gallery::cache_key_t key) noexcept;
+  PeerSender(const PeerSender&) = delete;
+  PeerSender(PeerSender&&) = delete;
+  PeerSender& operator=(const PeerSender&) = delete;
+  PeerSender& operator=(PeerSender&&) = delete;
+  ~PeerSender() override = default;
+
+  Status Step(DisplayGuard& display) noexcept override;
+  void Collect(const bmp::Rgb666* pixels,
+               std::size_t count,
+               DisplayGuard& display) noexcept override;
+  Status Transmit(io::Transmitter& transmitter,
+                  OutgoingRows& rows) noexcept override;
+
+ private:
+  ImageSender m_sender;
+};
+
+// Standalone mode: rows are converted on-board and recorded into the frame
+// cache as well. A complete picture is slid out if the orientation allows.
+class LocalSender final : public IPresenter {
+ public:
+  LocalSender(Image& image, gallery::cache_key_t key, bool slide) noexcept;
+  LocalSender(const LocalSender&) = delete;
+  LocalSender(LocalSender&&) = delete;
+  LocalSender& operator=(const LocalSender&) = delete;
+  LocalSender& operator=(LocalSender&&) = delete;
+  ~LocalSender() override = default;
+
+  Status Step(DisplayGuard& display) noexcept override;
+  void Collect(const bmp::Rgb666* pixels,
+               std::size_t count,
+               DisplayGuard& display) noexcept override;
+  Status Transmit(io::Transmitter& transmitter,
+                  OutgoingRows& rows) noexcept override;
+
+ private:
+  Status slide(DisplayGuard& display) noexcept;
+  // The row is converted while DMA writes the previous one
+  template <class Rows>
+  Status render_row(DisplayGuard& display, Rows& rows) noexcept;
+
+ private:
+  ImageSender m_sender;
+  std::optional<SlideTransition> m_transition;
+  std::array<ImageSender::converted_row_t, 2> m_rows;
+  std::array<ImageSender::native_row_t, 2> m_native_rows;
+  std::size_t m_rows_idx{0};
+};
+
+class SplitBalancer {
+ public:
+  explicit SplitBalancer(std::size_t peer_rows) noexcept;
+
+  [[nodiscard]] std::size_t GetPeerRows() const noexcept;
+
+  void Update(std::size_t peer_rows,
+              systick::microseconds_t peer_elapsed,
+              std::size_t local_rows,
+              systick::microseconds_t local_elapsed) noexcept;
+
+ private:
+  std::size_t m_peer_rows;
+};
+
+// The top rows of the image are converted by the peer, the bottom ones
+// on-board. Rows are drawn as soon as they are ready, each into its own
+// window, so both paths run concurrently.
+class SplitSender final : public IPresenter {
+ public:
+  using converted_row_t = ImageSender::converted_row_t;
+
+ public:
+  SplitSender(Image& image, SplitBalancer& balancer) noexcept;
+  SplitSender(const SplitSender&) = delete;
+  SplitSender(SplitSender&&) = delete;
+  SplitSender& operator=(const SplitSender&) = delete;
+  SplitSender& operator=(SplitSender&&) = delete;
+  ~SplitSender() override = default;
+
+  Status Step(DisplayGuard& display) noexcept override;
+  void Collect(const bmp::Rgb666* pixels,
+               std::size_t count,
+               DisplayGuard& display) noexcept override;
+  Status Transmit(io::Transmitter& transmitter,
+                  OutgoingRows& rows) noexcept override;
+
+ private:
+  static void draw_row(DisplayGuard& display,
+                       std::size_t row_idx,
+                       const converted_row_t& row) noexcept;
+  void update_balancer() noexcept;
+  [[nodiscard]] systick::microseconds_t get_elapsed() const noexcept;
+
+ private:
+  SplitBalancer& m_balancer;
+  std::size_t m_peer_rows;
+  std::size_t m_local_rows;
+  ImageSender m_peer;
+  ImageSender m_local;
+  systick::microseconds_t m_started_at;
+
+  converted_row_t m_peer_row;
+  std::size_t m_peer_pixels{0};
+  std::size_t m_peer_rows_drawn{0};
+  std::size_t m_local_rows_drawn{0};
+  systick::microseconds_t m_peer_elapsed{0};
+  systick::microseconds_t m_local_elapsed{0};
+};
+
+// The peer converts the rows in interlaced order, a coarse preview of the
+// whole picture is on the screen after the first pass
+class ProgressiveSender final : public IPresenter {
+ public:
+  using converted_row_t = ImageSender::converted_row_t;
+
+ public:
+  explicit ProgressiveSender(Image& image) noexcept;
+  ProgressiveSender(const ProgressiveSender&) = delete;
+  ProgressiveSender(ProgressiveSender&&) = delete;
+  ProgressiveSender& operator=(const ProgressiveSender&) = delete;
+  ProgressiveSender& operator=(ProgressiveSender&&) = delete;
+  ~ProgressiveSender() override = default;
+
+  Status Step(DisplayGuard& display) noexcept override;
+  void Collect(const bmp::Rgb666* pixels,
+               std::size_t count,
+               DisplayGuard& display) noexcept override;
+  Status Transmit(io::Transmitter& transmitter,
+                  OutgoingRows& rows) noexcept override;
+
+ private:
+  void draw_row(DisplayGuard& display) noexcept;
+
+ private:
+  ImageSender m_sender;
+  converted_row_t m_row;
+  std::size_t m_pixels{0};
+  std::size_t m_rows_drawn{0};
+};
+
+// Drawn through its own window once the picture is complete. Hiding it
+// converts the covered rows of the image file again, the rest of the
+// picture is left untouched.
+class Overlay {
+ public:
+  void Show(DisplayGuard& display, const char* text) noexcept;
+  bool Hide(DisplayGuard& display, Image& image) noexcept;
+  // The picture under the overlay has been redrawn
+  void Reset() noexcept;
+
+  [[nodiscard]] bool IsShown() const noexcept;
+
+ private:
+  static void set_band_window(DisplayGuard& display) noexcept;
+
+ private:
+  bool m_shown{false};
+};
+
+class ThumbnailSender final : public IPresenter {
+ public:
+  ThumbnailSender(fs::CyclicDirectoryIterator& dir_it,
+                  std::size_t cells_count) noexcept;
+  ThumbnailSender(const ThumbnailSender&) = delete;
+  ThumbnailSender(ThumbnailSender&&) = delete;
+  ThumbnailSender& operator=(const ThumbnailSender&) = delete;
+  ThumbnailSender& operator=(ThumbnailSender&&) = delete;
+  ~ThumbnailSender() override = default;
+
+  // Opens the window of the next cell once the previous one is filled
+  Status Step(DisplayGuard& display) noexcept override;
+  void Collect(const bmp::Rgb666* pixels,
+               std::size_t count,
+               DisplayGuard& display) noexcept override;
+  // Rows are copied, the next thumbnail is loaded while the rows of this
+  // one are still queued or kept for a resend
+  Status Transmit(io::Transmitter& transmitter,
+                  OutgoingRows& rows) noexcept override;
+
+ private:
+  bool load_next_thumbnail() noexcept;
+
+ private:
+  fs::CyclicDirectoryIterator& m_dir_it;
+  std::size_t m_cells_count;
+  std::size_t m_cells_sent{0};
+  std::size_t m_cells_drawn{0};
+  const gallery::Thumbnail* m_thumbnail{nullptr};
   std::size_t m_rows_idx{0};
 };
-}  // namespace pv
\ No newline at end of file
+
+class AnimationSender final : public IPresenter {
+ public:
+  struct Statistics {
+    std::uint32_t frames_shown;
+    std::uint32_t frames_late;     // presented after the deadline
+    std::uint32_t frames_dropped;  // skipped to catch up with the schedule
+    systick::milliseconds_t max_lateness;
+    systick::milliseconds_t elapsed;
+  };
+
+ private:
+  enum class State { Idle, Sending, Sent };
+
+  using pixel_t = bmp::Bgr888;
+
+ public:
+  AnimationSender(Animation& animation, std::uint16_t frame_rate) noexcept;
+  AnimationSender(const AnimationSender&) = delete;
+  AnimationSender(AnimationSender&&) = delete;
+  AnimationSender& operator=(const AnimationSender&) = delete;
+  AnimationSender& operator=(AnimationSender&&) = delete;
+  ~AnimationSender() override = default;
+
+  // Opens the window of the next frame once the previous one is filled
+  Status Step(DisplayGuard& display) noexcept override;
+  void Collect(const bmp::Rgb666* pixels,
+               std::size_t count,
+               DisplayGuard& display) noexcept override;
+  Status Transmit(io::Transmitter& transmitter,
+                  OutgoingRows& rows) noexcept override;
+  void NotifyPresented() noexcept override;
+
+  [[nodiscard]] const Statistics& GetStatistics() const noexcept;
+
+ private:
+  bool start_frame() noexcept;
+  bool send_row(io::Transmitter& transmitter, OutgoingRows& rows) noexcept;
+  void restart() noexcept;
+
+  std::optional<anim::FrameHeader> read_frame_header(
+      std::uint32_t offset) noexcept;
+  [[nodiscard]] systick::milliseconds_t get_frame_start(
+      std::size_t frame_idx) const noexcept;
+  [[nodiscard]] systick::milliseconds_t get_loop_time() const noexcept;
+
+ private:
+  Animation& m_animation;
+  std::uint16_t m_frame_rate;
+  systick::milliseconds_t m_started_at;
+  systick::milliseconds_t m_loop_started_at;
+
+  State m_state{State::Idle};
+  anim::FrameHeader m_frame{};
+  bool m_window_pending{false};
+  std::size_t m_frame_idx{0};
+  std::uint32_t m_frame_offset{anim::Animation::HEADER_RAW_SIZE};
+  std::uint32_t m_next_frame_offset{0};
+  std::uint16_t m_rows_idx{0};
+  bool m_row_loaded{false};
+
+  Statistics m_statistics{};
+};
+
+// The pictures of the directory one by one or as pages of thumbnails.
+// Owns the presenter of the current picture, the commands replace it.
+class Slideshow {
+  using presenter_t = std::variant<std::monostate,
+                                   PeerSender,
+                                   LocalSender,
+                                   SplitSender,
+                                   ProgressiveSender,
+                                   ThumbnailSender,
+                                   AnimationSender>;
+
+ public:
+  Slideshow(fs::CyclicDirectoryIterator dir_it,
+            std::size_t image_count,
+            DisplayGuard& display,
+            io::Transmitter& transmitter) noexcept;
+  Slideshow(const Slideshow&) = delete;
+  Slideshow(Slideshow&&) = delete;
+  Slideshow& operator=(const Slideshow&) = delete;
+  Slideshow& operator=(Slideshow&&) = delete;
+  ~Slideshow() = default;
+
+  // nullptr if nothing is on its way to the screen
+  [[nodiscard]] IPresenter* GetPresenter() noexcept;
+  // The picture is on the screen, the commands are executed next
+  void NotifyPresented() noexcept;
+
+  bool ShowNext() noexcept;
+  bool ToggleGrid() noexcept;
+  void SwitchRenderMode() noexcept;
+  bool ToggleOverlay() noexcept;
+
+ private:
+  bool show_next_picture() noexcept;
+  bool show_next_page() noexcept;
+  void advance_picture(std::size_t count) noexcept;
+  void reset() noexcept;
+
+  template <class Presenter, class... Args>
+  void present(Args&&... args) noexcept {
+    m_presenter = std::addressof(
+        m_senders.emplace<Presenter>(std::forward<Args>(args)...));
+  }
+
+ private:
+  fs::CyclicDirectoryIterator m_dir_it;
+  std::size_t m_image_count;
+  DisplayGuard& m_display;
+  io::Transmitter& m_transmitter;
+
+  std::optional<Image> m_image;
+  std::optional<Animation> m_animation;
+  presenter_t m_senders;
+  IPresenter* m_presenter{nullptr};
+
+  Overlay m_overlay;
+  osd::text_t m_overlay_text{};
+  bool m_overlay_enabled{OVERLAY_ENABLED};
+  std::size_t m_picture_idx{0};
+  bool m_grid_mode{false};
+  RenderMode m_render_mode{DEFAULT_RENDER_MODE};
+  SplitBalancer m_split_balancer{HYBRID_PEER_ROWS};
+};
+}  // namespace pv
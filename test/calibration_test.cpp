@@ -0,0 +1,139 @@
+#include "check.hpp"
+
+#include <display/calibration.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+using namespace std;
+
+namespace {
+constexpr fsmc::Timings REFERENCE{6, 2, 3};
+
+// The panel latches a word only if the write cycle meets its minimum
+// address setup, address hold and data setup, and optionally a minimum
+// whole cycle. A shorter cycle garbles the word, as a real bus would.
+class PanelModel {
+ public:
+  static constexpr size_t PIXELS{16};
+
+ public:
+  PanelModel(const fsmc::Timings& minimum, uint8_t min_cycle = 0) noexcept
+      : m_minimum{minimum}, m_min_cycle{min_cycle} {}
+
+  bool Verify(const fsmc::Timings& timings) noexcept {
+    ++m_probes_count;
+    for (size_t idx = 0; idx < PIXELS; ++idx) {
+      write(idx, pattern(idx), timings);
+    }
+    for (size_t idx = 0; idx < PIXELS; ++idx) {
+      if (m_gram[idx] != pattern(idx)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]] size_t GetProbesCount() const noexcept {
+    return m_probes_count;
+  }
+
+ private:
+  static uint16_t pattern(size_t idx) noexcept {
+    return idx % 2 == 0 ? uint16_t{0xA854} : uint16_t{0x54A8};
+  }
+
+  void write(size_t idx, uint16_t word, const fsmc::Timings& timings) noexcept {
+    const bool latched{
+        timings.address_setup >= m_minimum.address_setup &&
+        timings.address_hold >= m_minimum.address_hold &&
+        timings.data_setup >= m_minimum.data_setup &&
+        timings.address_setup + timings.address_hold + timings.data_setup >=
+            m_min_cycle};
+    m_gram[idx] = latched ? word : static_cast<uint16_t>(word ^ 0x0400);
+  }
+
+ private:
+  fsmc::Timings m_minimum;
+  uint8_t m_min_cycle;
+  array<uint16_t, PIXELS> m_gram{};
+  size_t m_probes_count{0};
+};
+
+optional<fsmc::Timings> calibrate(PanelModel& panel, uint8_t margin) noexcept {
+  return fsmc::CalibrateTimings(
+      [&panel](const fsmc::Timings& candidate) {
+        return panel.Verify(candidate);
+      },
+      REFERENCE, margin);
+}
+
+size_t field_probes(uint8_t minimum,
+                    uint8_t reference,
+                    uint8_t lowest) noexcept {
+  return minimum < reference ? minimum - lowest + 1u : reference - lowest;
+}
+
+// Every combination of per-field minimums up to the reference: without a
+// margin the smallest passing timings are taken, and each field search
+// stops at its first passing value
+void check_smallest_passing() {
+  for (uint8_t setup = 0; setup <= REFERENCE.address_setup; ++setup) {
+    for (uint8_t hold = 1; hold <= REFERENCE.address_hold; ++hold) {
+      for (uint8_t data = 1; data <= REFERENCE.data_setup; ++data) {
+        const fsmc::Timings minimum{setup, hold, data};
+        PanelModel panel{minimum};
+        const auto timings{calibrate(panel, 0)};
+        CHECK(timings && *timings == minimum);
+
+        const size_t expected_probes{
+            1 +
+            field_probes(setup, REFERENCE.address_setup,
+                         fsmc::Timings::ADDRESS_SETUP_MIN) +
+            field_probes(hold, REFERENCE.address_hold,
+                         fsmc::Timings::ADDRESS_HOLD_MIN) +
+            field_probes(data, REFERENCE.data_setup,
+                         fsmc::Timings::DATA_SETUP_MIN) +
+            (minimum != REFERENCE ? 1 : 0) + 1};
+        CHECK(panel.GetProbesCount() == expected_probes);
+      }
+    }
+  }
+}
+
+void check_margin() {
+  PanelModel panel{{2, 1, 1}};
+  const auto timings{calibrate(panel, 2)};
+  CHECK(timings && *timings == (fsmc::Timings{4, 2, 3}));
+}
+
+// Fields that pass one by one may fail together: the combination is
+// relaxed a cycle at a time until it passes
+void check_relaxed_combination() {
+  PanelModel panel{{1, 1, 1}, 7};
+  const auto timings{calibrate(panel, 0)};
+  CHECK(timings && *timings == (fsmc::Timings{3, 2, 2}));
+  CHECK(panel.Verify(*timings));
+}
+
+// A panel slower than the reference: nothing passes, the caller keeps the
+// reference timings
+void check_fallback() {
+  PanelModel slow_setup{{7, 1, 1}};
+  CHECK(!calibrate(slow_setup, 0));
+  CHECK(slow_setup.GetProbesCount() == 1);
+
+  PanelModel slow_data{{0, 1, 4}};
+  CHECK(!calibrate(slow_data, 1));
+}
+}  // namespace
+
+int main() {
+  check_smallest_passing();
+  check_margin();
+  check_relaxed_combination();
+  check_fallback();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// Host tests are plain executables: the first failed check reports its
+// location and aborts, CTest takes the exit status
+#define CHECK(condition)                                            \
+  do {                                                              \
+    if (!(condition)) {                                             \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+                   __LINE__, #condition);                           \
+      std::abort();                                                 \
+    }                                                               \
+  } while (false)
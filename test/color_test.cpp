@@ -0,0 +1,87 @@
+#include "check.hpp"
+
+#include <display/color.hpp>
+
+#include <array>
+#include <cstring>
+#include <random>
+
+using namespace std;
+
+namespace {
+constexpr size_t MAX_COUNT{67};
+constexpr size_t MAX_OFFSET{4};
+
+bool operator==(const bmp::Rgb666& lhs, const bmp::Rgb666& rhs) noexcept {
+  return lhs.red_green == rhs.red_green && lhs.blue == rhs.blue;
+}
+
+// Every count up to a few whole steps, so each tail length is covered, at
+// every byte offset of the input and every aligned offset of the output (the
+// tail is stored through bmp::Rgb666). Only the portable path is built on the
+// host: the __PKHBT and __ROR path of Cortex-M4 DSP isn't covered here.
+void check_against_scalar(mt19937& engine) {
+  array<byte, MAX_COUNT * sizeof(bmp::Bgr888) + MAX_OFFSET> input_storage;
+  alignas(bmp::Rgb666) array<byte, (MAX_COUNT + 1) * sizeof(bmp::Rgb666) +
+                                       MAX_OFFSET> output_storage;
+  uniform_int_distribution<unsigned> random_byte{0, 0xFF};
+
+  for (size_t count = 0; count <= MAX_COUNT; ++count) {
+    for (size_t in_offset = 0; in_offset < MAX_OFFSET; ++in_offset) {
+      for (size_t out_offset = 0; out_offset < MAX_OFFSET;
+           out_offset += alignof(bmp::Rgb666)) {
+        for (auto& value : input_storage) {
+          value = static_cast<byte>(random_byte(engine));
+        }
+        output_storage.fill(byte{0xA5});
+
+        const auto* pixels{reinterpret_cast<const bmp::Bgr888*>(
+            data(input_storage) + in_offset)};
+        auto* out{reinterpret_cast<bmp::Rgb666*>(data(output_storage) +
+                                                 out_offset)};
+        color::ToRgb666(pixels, count, out);
+
+        for (size_t idx = 0; idx < count; ++idx) {
+          bmp::Bgr888 source;
+          memcpy(addressof(source),
+                 data(input_storage) + in_offset + idx * sizeof(source),
+                 sizeof(source));
+          bmp::Rgb666 converted;
+          memcpy(addressof(converted),
+                 data(output_storage) + out_offset + idx * sizeof(converted),
+                 sizeof(converted));
+          CHECK(converted == color::ToRgb666(source));
+        }
+        // Nothing is written past the last pixel
+        const size_t end{out_offset + count * sizeof(bmp::Rgb666)};
+        for (size_t idx = end; idx < size(output_storage); ++idx) {
+          CHECK(output_storage[idx] == byte{0xA5});
+        }
+      }
+    }
+  }
+}
+
+void check_channel_extremes() {
+  constexpr size_t COUNT{5};
+  const array<bmp::Bgr888, COUNT> pixels{{{0x00, 0x00, 0x00},
+                                          {0xFF, 0xFF, 0xFF},
+                                          {0x03, 0x03, 0x03},
+                                          {0xFC, 0x00, 0x00},
+                                          {0x00, 0x00, 0xFC}}};
+  array<bmp::Rgb666, COUNT> out{};
+  color::ToRgb666(data(pixels), COUNT, data(out));
+  for (size_t idx = 0; idx < COUNT; ++idx) {
+    CHECK(out[idx] == color::ToRgb666(pixels[idx]));
+  }
+  CHECK(out[1].red_green == 0xFCFC && out[1].blue == 0xFC00);
+  CHECK(out[2].red_green == 0 && out[2].blue == 0);
+}
+}  // namespace
+
+int main() {
+  mt19937 engine{29};
+  check_against_scalar(engine);
+  check_channel_extremes();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,334 @@
+#include "emulator.hpp"
+#include "check.hpp"
+
+#include <transceiver/receiver.hpp>
+#include <transceiver/transmitter.hpp>
+#include <tools/attributes.hpp>
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+EXTERN_C void EXTI9_5_IRQHandler();
+EXTERN_C void TIM6_IRQHandler();
+EXTERN_C void USART6_IRQHandler();
+EXTERN_C void DMA2_Stream1_IRQHandler();
+EXTERN_C void SysTick_Handler();
+
+namespace emu {
+namespace {
+constexpr microseconds_t TICK_PERIOD{1000};
+constexpr uint32_t APB2_CLOCK{16'000'000};  // as io::Receiver assumes
+constexpr uint32_t FRAME_BITS{10};          // 8N1
+constexpr uint32_t OVERWRITE_LINE{5}, CLEAR_TO_SEND_LINE{6};
+constexpr uint32_t RTS_PIN{7}, DATA_SHIFT{8};
+
+Emulator* instance{nullptr};
+
+// As io::Receiver sets BRR
+uint32_t to_divider(size_t speed_idx) noexcept {
+  const uint32_t speed{io::Receiver::SPEEDS[speed_idx]};
+  return (APB2_CLOCK + speed / 2) / speed;
+}
+
+// DMA address registers are 32 bits wide, the rest of a host address is
+// taken from the object that owns the buffer
+template <class Ty, class Owner>
+Ty* to_pointer(uint32_t address, const Owner& owner) {
+  const auto base{reinterpret_cast<uintptr_t>(addressof(owner))};
+  const auto full{(base & ~uintptr_t{0xFFFFFFFF}) | address};
+  CHECK(full >= base && full < base + sizeof(Owner));
+  return reinterpret_cast<Ty*>(full);
+}
+
+template <class Ty>
+uint32_t to_address(const Ty* ptr) noexcept {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr));
+}
+}  // namespace
+
+Emulator::Emulator(const Settings& settings)
+    : m_settings{settings},
+      m_engine{settings.seed},
+      m_peer{settings.nak_delay, settings.nak_retry, settings.peer} {
+  CHECK(!instance);
+  instance = this;
+  fake::SetResetRegister::hook = on_bsrr;
+  schedule(TICK_PERIOD, [this] { tick(); });
+}
+
+Emulator::~Emulator() {
+  fake::SetResetRegister::hook = nullptr;
+  instance = nullptr;
+}
+
+void Emulator::Step() {
+  poll_peripherals();
+  CHECK(!m_events.empty());
+  const Event event{m_events.top()};
+  m_events.pop();
+  m_now = event.time;
+  update_systick();
+  event.action();
+  m_peer.Poll(m_now);
+  wake_peer();
+  start_return_byte();
+  poll_peripherals();
+}
+
+microseconds_t Emulator::Now() const noexcept {
+  return m_now;
+}
+
+Peer& Emulator::GetPeer() noexcept {
+  return m_peer;
+}
+
+uint32_t Emulator::GetLostBytes() const noexcept {
+  return m_lost_bytes;
+}
+
+void Emulator::schedule(microseconds_t delay, function<void()> action) {
+  m_events.push(Event{m_now + delay, m_order++, move(action)});
+}
+
+// The drivers start the strobe timer and a burst by enabling them, the
+// emulator picks that up after every event and every firmware step
+void Emulator::poll_peripherals() {
+  if (READ_BIT(TIM6->CR1, TIM_CR1_CEN) && !m_timer_running) {
+    m_timer_running = true;
+    // PSC makes it count microseconds
+    schedule(TIM6->ARR, [this] { expire_timer(); });
+  }
+  if (READ_BIT(TIM1->CR1, TIM_CR1_CEN) &&
+      READ_BIT(DMA2_Stream5->CR, DMA_SxCR_EN) && !m_burst_running) {
+    m_burst_running = true;
+    const uint64_t cycles{uint64_t{DMA2_Stream5->NDTR} * (TIM1->ARR + 1)};
+    const uint64_t cycles_per_us{SystemCoreClock / 1'000'000};
+    schedule(max<uint64_t>(1, (cycles + cycles_per_us - 1) / cycles_per_us),
+             [this] { run_burst(); });
+  }
+}
+
+void Emulator::tick() {
+  m_ticked_at = m_now;
+  SysTick_Handler();
+  schedule(TICK_PERIOD, [this] { tick(); });
+}
+
+// The peer sends a NAK when it's due, not with the next line change
+void Emulator::wake_peer() {
+  const auto due{m_peer.GetNextNak()};
+  if (!due || (m_peer_wakeup && *m_peer_wakeup <= *due)) {
+    return;
+  }
+  m_peer_wakeup = due;
+  schedule(*due - m_now, [this] { m_peer_wakeup.reset(); });
+}
+
+// The counter goes down from LOAD within a tick. A tick due at this very
+// moment may not be handled yet, then the counter is about to reload.
+void Emulator::update_systick() const {
+  if (const uint32_t reload = SysTick->LOAD; reload) {
+    const microseconds_t elapsed{min(m_now - m_ticked_at, TICK_PERIOD - 1)};
+    SysTick->VAL = static_cast<uint32_t>(reload - elapsed * (reload + 1) /
+                                                      TICK_PERIOD);
+  }
+}
+
+void Emulator::on_bsrr(fake::SetResetRegister& target, uint32_t) {
+  if (addressof(target) != addressof(GPIOB->BSRR)) {
+    return;
+  }
+  const uint32_t output{GPIOB->ODR};
+  const bool rts{READ_BIT(output, 1u << RTS_PIN) != 0};
+  if (rts && !instance->m_rts) {
+    instance->on_strobe(static_cast<byte>(output >> DATA_SHIFT & 0xFF));
+  }
+  instance->m_rts = rts;
+}
+
+// A strobe before the previous one is answered breaks the handshake. An
+// overwritten byte isn't taken, it's strobed again.
+void Emulator::on_strobe(byte value) {
+  if (m_bursting) {
+    m_taken.push_back(value);
+    return;
+  }
+  CHECK(!m_answering);
+  m_answering = true;
+  const bool overwrite{chance(m_settings.overwrite_rate)};
+  m_taken.assign(overwrite ? 0 : 1, value);
+  schedule(response_time(), [this, overwrite] { answer(overwrite); });
+}
+
+void Emulator::answer(bool overwrite) {
+  m_answering = false;
+  if (overwrite) {
+    m_taken.clear();
+    pulse(OVERWRITE_LINE);
+    return;
+  }
+  for (byte value : m_taken) {
+    if (m_peer.IsWithinChecked() && chance(m_settings.data_error_rate)) {
+      value ^= static_cast<byte>(1u << uniform_int_distribution<>{0, 7}(
+                                     m_engine));
+    }
+    m_peer.Take(value, m_now);
+  }
+  m_taken.clear();
+  pulse(CLEAR_TO_SEND_LINE);
+}
+
+// The stream writes the prepared BSRR words and stops, the peer answers
+// the whole burst at once
+void Emulator::run_burst() {
+  m_burst_running = false;
+  auto& stream{*DMA2_Stream5};
+  if (!READ_BIT(TIM1->CR1, TIM_CR1_CEN) || !READ_BIT(stream.CR, DMA_SxCR_EN)) {
+    return;
+  }
+  CHECK(stream.PAR == to_address(addressof(GPIOB->BSRR)));
+  CHECK(READ_BIT(TIM1->DIER, TIM_DIER_UDE));
+  CHECK(!m_answering);
+  const auto* words{
+      to_pointer<const uint32_t>(stream.M0AR, io::Transmitter::GetInstance())};
+
+  m_bursting = true;
+  m_taken.clear();
+  for (uint32_t idx = 0; idx < stream.NDTR; ++idx) {
+    GPIOB->BSRR = words[idx];
+  }
+  m_bursting = false;
+  stream.NDTR = 0;
+  CLEAR_BIT(stream.CR, DMA_SxCR_EN);
+
+  m_answering = true;
+  const bool overwrite{chance(m_settings.overwrite_rate)};
+  schedule(response_time(), [this, overwrite] { answer(overwrite); });
+}
+
+void Emulator::pulse(uint32_t line) {
+  const uint32_t mask{1u << line};
+  CHECK(READ_BIT(EXTI->IMR, mask) && READ_BIT(EXTI->RTSR, mask));
+  CHECK(fake::IsEnabled(EXTI9_5_IRQn));
+  SET_BIT(EXTI->PR, mask);
+  EXTI9_5_IRQHandler();
+  CLEAR_BIT(EXTI->PR, mask);
+}
+
+// A one-pulse timer stops itself
+void Emulator::expire_timer() {
+  m_timer_running = false;
+  CLEAR_BIT(TIM6->CR1, TIM_CR1_CEN);
+  CHECK(READ_BIT(TIM6->CR1, TIM_CR1_OPM) &&
+        READ_BIT(TIM6->DIER, TIM_DIER_UIE));
+  CHECK(fake::IsEnabled(TIM6_IRQn));
+  SET_BIT(TIM6->SR, TIM_SR_UIF);
+  TIM6_IRQHandler();
+  CHECK(!READ_BIT(TIM6->SR, TIM_SR_UIF));
+}
+
+void Emulator::start_return_byte() {
+  if (m_returning) {
+    return;
+  }
+  const auto next{m_peer.NextReturnByte()};
+  if (!next) {
+    return;
+  }
+  m_returning = true;
+  const size_t speed_idx{m_peer.GetSpeed()};
+  schedule(return_byte_time(speed_idx), [this, next = *next, speed_idx] {
+    m_returning = false;
+    byte value{next.value};
+    if (next.checked && chance(m_settings.return_error_rate)) {
+      value ^= static_cast<byte>(1u << uniform_int_distribution<>{0, 7}(
+                                     m_engine));
+    }
+    receive(value, speed_idx);
+    ++m_bytes_returned;
+    start_return_byte();
+    if (!m_returning) {
+      schedule(return_byte_time(speed_idx),
+               [this, count = m_bytes_returned] { check_idle(count); });
+    }
+  });
+}
+
+// DMA2 stream 1 moves each byte from DR into the circular buffer of the
+// receiver and raises the half and complete transfer interrupts. A byte at
+// the wrong rate is moved all the same.
+void Emulator::receive(byte value, size_t speed_idx) {
+  auto& stream{*DMA2_Stream1};
+  if (!READ_BIT(USART6->CR1, USART_CR1_UE) ||
+      !READ_BIT(USART6->CR1, USART_CR1_RE) ||
+      !READ_BIT(stream.CR, DMA_SxCR_EN)) {
+    ++m_lost_bytes;
+    return;
+  }
+  CHECK(READ_BIT(USART6->CR3, USART_CR3_DMAR));
+  CHECK(stream.PAR == to_address(addressof(USART6->DR)));
+  CHECK(READ_BIT(stream.CR, DMA_SxCR_CIRC));
+  if (to_divider(speed_idx) != USART6->BRR) {
+    SET_BIT(USART6->SR, USART_SR_FE);
+    if (READ_BIT(USART6->CR3, USART_CR3_EIE)) {
+      CHECK(fake::IsEnabled(USART6_IRQn));
+      USART6_IRQHandler();
+    }
+    CLEAR_BIT(USART6->SR, USART_SR_FE);
+  }
+
+  m_stream_size = max<size_t>(m_stream_size, stream.NDTR);
+  auto* buffer{to_pointer<byte>(stream.M0AR, io::Receiver::GetInstance())};
+  buffer[m_stream_size - stream.NDTR] = value;
+  stream.NDTR = stream.NDTR - 1;
+  if (stream.NDTR == m_stream_size / 2 &&
+      READ_BIT(stream.CR, DMA_SxCR_HTIE)) {
+    raise_stream_interrupt(DMA_LISR_HTIF1);
+  }
+  if (stream.NDTR == 0) {
+    stream.NDTR = static_cast<uint32_t>(m_stream_size);
+    if (READ_BIT(stream.CR, DMA_SxCR_TCIE)) {
+      raise_stream_interrupt(DMA_LISR_TCIF1);
+    }
+  }
+}
+
+void Emulator::raise_stream_interrupt(uint32_t flag) {
+  CHECK(fake::IsEnabled(DMA2_Stream1_IRQn));
+  SET_BIT(DMA2->LISR, flag);
+  DMA2_Stream1_IRQHandler();
+  CLEAR_BIT(DMA2->LISR, DMA2->LIFCR);
+  DMA2->LIFCR = 0;
+}
+
+// IDLE is set after a whole frame of silence
+void Emulator::check_idle(uint64_t bytes_returned) {
+  if (m_returning || bytes_returned != m_bytes_returned ||
+      !READ_BIT(USART6->CR1, USART_CR1_UE)) {
+    return;
+  }
+  SET_BIT(USART6->SR, USART_SR_IDLE);
+  if (READ_BIT(USART6->CR1, USART_CR1_IDLEIE)) {
+    CHECK(fake::IsEnabled(USART6_IRQn));
+    USART6_IRQHandler();
+  }
+  CLEAR_BIT(USART6->SR, USART_SR_IDLE);
+}
+
+bool Emulator::chance(double rate) {
+  return rate > 0 && uniform_real_distribution<>{0, 1}(m_engine) < rate;
+}
+
+microseconds_t Emulator::response_time() {
+  return uniform_int_distribution<microseconds_t>{
+      m_settings.min_response, m_settings.max_response}(m_engine);
+}
+
+microseconds_t Emulator::return_byte_time(size_t speed_idx) noexcept {
+  const uint64_t divider{to_divider(speed_idx)};
+  return (FRAME_BITS * divider * 1'000'000 + APB2_CLOCK - 1) / APB2_CLOCK;
+}
+}  // namespace emu
\ No newline at end of file
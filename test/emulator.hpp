@@ -0,0 +1,111 @@
+#pragma once
+#include "peer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include <stm32f4xx.h>
+
+namespace emu {
+struct Settings {
+  std::uint32_t seed{1};
+  // The peer answers a strobe (or a burst) within this range
+  microseconds_t min_response{2};
+  microseconds_t max_response{6};
+  double overwrite_rate{0};     // answers that are OV instead of CTS
+  double data_error_rate{0};    // damaged v2 bytes on the data lines
+  double return_error_rate{0};  // damaged v2 bytes on the return path
+  microseconds_t nak_delay{20};
+  // Longer than a NAK takes at 115200 baud, or the line never goes idle
+  microseconds_t nak_retry{3000};
+  Capabilities peer{};
+};
+
+// Runs the link drivers against the peer in virtual time. The firmware
+// side runs between the events, each event is a line change at the peer
+// that raises an interrupt through the real handler: CTS and OV (EXTI9_5),
+// the strobe timer (TIM6), bytes and the idle line on the return path
+// (DMA2 stream 1, USART6) and the system tick. The timers and DMA streams
+// are started by the drivers through the faked registers. The peer sends
+// at its own rate, a byte sent at another one than the receiver is set to
+// arrives with a framing error.
+class Emulator {
+ public:
+  explicit Emulator(const Settings& settings);
+  Emulator(const Emulator&) = delete;
+  Emulator(Emulator&&) = delete;
+  Emulator& operator=(const Emulator&) = delete;
+  Emulator& operator=(Emulator&&) = delete;
+  ~Emulator();
+
+  // Runs the next event
+  void Step();
+  [[nodiscard]] microseconds_t Now() const noexcept;
+
+  [[nodiscard]] Peer& GetPeer() noexcept;
+  // Bytes the return path lost as the receiver wasn't listening
+  [[nodiscard]] std::uint32_t GetLostBytes() const noexcept;
+
+ private:
+  struct Event {
+    microseconds_t time;
+    std::uint64_t order;
+    std::function<void()> action;
+
+    bool operator>(const Event& other) const noexcept {
+      return time != other.time ? time > other.time : order > other.order;
+    }
+  };
+
+  void schedule(microseconds_t delay, std::function<void()> action);
+  void poll_peripherals();
+  void tick();
+  void wake_peer();
+  void update_systick() const;
+
+  static void on_bsrr(fake::SetResetRegister& target, std::uint32_t value);
+  void on_strobe(std::byte value);
+  void answer(bool overwrite);
+  void run_burst();
+
+  void pulse(std::uint32_t line);
+  void expire_timer();
+
+  void start_return_byte();
+  void receive(std::byte value, std::size_t speed_idx);
+  void raise_stream_interrupt(std::uint32_t flag);
+  void check_idle(std::uint64_t bytes_received);
+
+  [[nodiscard]] bool chance(double rate);
+  [[nodiscard]] microseconds_t response_time();
+  [[nodiscard]] static microseconds_t return_byte_time(
+      std::size_t speed_idx) noexcept;
+
+ private:
+  Settings m_settings;
+  std::mt19937 m_engine;
+  Peer m_peer;
+  microseconds_t m_now{0};
+  microseconds_t m_ticked_at{0};
+  std::uint64_t m_order{0};
+  std::optional<microseconds_t> m_peer_wakeup;
+  std::priority_queue<Event, std::vector<Event>, std::greater<>> m_events;
+
+  bool m_rts{false};
+  bool m_answering{false};
+  bool m_timer_running{false};
+  bool m_burst_running{false};
+  bool m_bursting{false};
+  std::vector<std::byte> m_taken;  // until the strobe or burst is answered
+
+  bool m_returning{false};
+  std::uint64_t m_bytes_returned{0};
+  std::size_t m_stream_size{0};
+  std::uint32_t m_lost_bytes{0};
+};
+}  // namespace emu
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include <stm32f4xx.h>
+
+#include <array>
+
+using namespace std;
+
+uint32_t SystemCoreClock{100'000'000};
+
+namespace fake {
+namespace {
+constexpr size_t IRQ_COUNT{128};
+
+array<bool, IRQ_COUNT> enabled_irqs{};
+}  // namespace
+
+GPIO_TypeDef gpioa{}, gpiob{}, gpioc{}, gpiod{}, gpioe{}, gpiof{}, gpiog{},
+    gpioh{};
+RCC_TypeDef rcc{};
+EXTI_TypeDef exti{};
+SYSCFG_TypeDef syscfg{};
+TIM_TypeDef tim1{}, tim6{};
+DMA_TypeDef dma2{};
+DMA_Stream_TypeDef dma2_stream1{}, dma2_stream5{};
+USART_TypeDef usart6{};
+SysTick_Type systick{};
+
+bool IsEnabled(IRQn_Type irq) noexcept {
+  return enabled_irqs[static_cast<size_t>(irq)];
+}
+}  // namespace fake
+
+void NVIC_EnableIRQ(IRQn_Type irq) noexcept {
+  fake::enabled_irqs[static_cast<size_t>(irq)] = true;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq) noexcept {
+  fake::enabled_irqs[static_cast<size_t>(irq)] = false;
+}
+
+void NVIC_SetPriority(IRQn_Type, uint32_t) noexcept {}
+
+uint32_t SysTick_Config(uint32_t ticks) noexcept {
+  fake::systick.LOAD = ticks - 1;
+  fake::systick.VAL = 0;
+  return 0;
+}
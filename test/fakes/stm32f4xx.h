@@ -0,0 +1,114 @@
+#pragma once
+// For #include_next, the device header itself is a system one
+#pragma GCC system_header
+#include <cstdint>
+
+// The device header as it is, except for the core functions and the
+// peripherals the link drivers touch: those are host objects, so the
+// emulator can watch the registers and raise the interrupts itself
+#define GPIO_TypeDef cmsis_GPIO_TypeDef
+#define NVIC_EnableIRQ cmsis_NVIC_EnableIRQ
+#define NVIC_DisableIRQ cmsis_NVIC_DisableIRQ
+#define NVIC_SetPriority cmsis_NVIC_SetPriority
+#define SysTick_Config cmsis_SysTick_Config
+#include_next <stm32f4xx.h>
+#undef GPIO_TypeDef
+#undef NVIC_EnableIRQ
+#undef NVIC_DisableIRQ
+#undef NVIC_SetPriority
+#undef SysTick_Config
+
+namespace fake {
+// BSRR is write-only on the chip: a write sets and resets bits of ODR at
+// once, and the emulator is told about every one of them
+class SetResetRegister {
+ public:
+  using hook_t = void (*)(SetResetRegister& target, std::uint32_t value);
+
+ public:
+  explicit SetResetRegister(volatile std::uint32_t& output) noexcept
+      : m_output{output} {}
+
+  SetResetRegister& operator=(std::uint32_t value) noexcept {
+    m_output = (m_output & ~(value >> 16)) | (value & 0xFFFF);
+    if (hook) {
+      hook(*this, value);
+    }
+    return *this;
+  }
+
+  static inline hook_t hook{nullptr};
+
+ private:
+  volatile std::uint32_t& m_output;
+};
+}  // namespace fake
+
+struct GPIO_TypeDef {
+  __IO uint32_t MODER;
+  __IO uint32_t OTYPER;
+  __IO uint32_t OSPEEDR;
+  __IO uint32_t PUPDR;
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+  fake::SetResetRegister BSRR{ODR};
+  __IO uint32_t LCKR;
+  __IO uint32_t AFR[2];
+};
+
+namespace fake {
+extern GPIO_TypeDef gpioa, gpiob, gpioc, gpiod, gpioe, gpiof, gpiog, gpioh;
+extern RCC_TypeDef rcc;
+extern EXTI_TypeDef exti;
+extern SYSCFG_TypeDef syscfg;
+extern TIM_TypeDef tim1, tim6;
+extern DMA_TypeDef dma2;
+extern DMA_Stream_TypeDef dma2_stream1, dma2_stream5;
+extern USART_TypeDef usart6;
+extern SysTick_Type systick;
+
+[[nodiscard]] bool IsEnabled(IRQn_Type irq) noexcept;
+}  // namespace fake
+
+void NVIC_EnableIRQ(IRQn_Type irq) noexcept;
+void NVIC_DisableIRQ(IRQn_Type irq) noexcept;
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) noexcept;
+uint32_t SysTick_Config(uint32_t ticks) noexcept;
+
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#undef GPIOF
+#undef GPIOG
+#undef GPIOH
+#undef RCC
+#undef EXTI
+#undef SYSCFG
+#undef TIM1
+#undef TIM6
+#undef DMA2
+#undef DMA2_Stream1
+#undef DMA2_Stream5
+#undef USART6
+#undef SysTick
+
+#define GPIOA (&fake::gpioa)
+#define GPIOB (&fake::gpiob)
+#define GPIOC (&fake::gpioc)
+#define GPIOD (&fake::gpiod)
+#define GPIOE (&fake::gpioe)
+#define GPIOF (&fake::gpiof)
+#define GPIOG (&fake::gpiog)
+#define GPIOH (&fake::gpioh)
+#define RCC (&fake::rcc)
+#define EXTI (&fake::exti)
+#define SYSCFG (&fake::syscfg)
+#define TIM1 (&fake::tim1)
+#define TIM6 (&fake::tim6)
+#define DMA2 (&fake::dma2)
+#define DMA2_Stream1 (&fake::dma2_stream1)
+#define DMA2_Stream5 (&fake::dma2_stream5)
+#define USART6 (&fake::usart6)
+#define SysTick (&fake::systick)
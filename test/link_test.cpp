@@ -0,0 +1,463 @@
+#include "check.hpp"
+#include "emulator.hpp"
+
+#include <display/color.hpp>
+#include <transceiver/negotiation.hpp>
+#include <transceiver/receiver.hpp>
+#include <transceiver/request_parser.hpp>
+#include <transceiver/transmitter.hpp>
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr size_t PIXEL_SIZE{3};
+constexpr size_t ROW_PIXELS{240};
+constexpr size_t ROW_SIZE{ROW_PIXELS * PIXEL_SIZE};
+constexpr size_t ROWS_PER_FRAME{24};
+constexpr size_t FRAMES_COUNT{2};
+constexpr size_t ROW_BUFFERS{6};
+constexpr systick::milliseconds_t TEST_TIMEOUT{50};  // as the viewer's
+constexpr emu::microseconds_t TIME_LIMIT{10'000'000};
+
+using row_t = vector<byte>;
+using parser_t = pv::RequestParser<8, 256>;
+
+const array<cmd::Command, 3> COMMANDS_SENT{
+    cmd::Command{cmd::Command::Type::GreenLedOn},
+    cmd::Command{cmd::Command::Type::BlueLedOff},
+    cmd::Command{cmd::Command::Type::GreenLedOff}};
+const cmd::Command COMMAND_RETURNED{cmd::Command::Type::NextPicture};
+
+// Flat runs, a gradient, the row above with a few pixels changed and
+// noise: every filter of the codec is taken, and some rows stay raw
+vector<row_t> make_rows(mt19937& engine) {
+  uniform_int_distribution<unsigned> random_byte{0, 0xFF};
+  uniform_int_distribution<size_t> random_pixel{0, ROW_PIXELS - 1};
+  vector<row_t> rows;
+  for (size_t idx = 0; idx < FRAMES_COUNT * ROWS_PER_FRAME; ++idx) {
+    row_t row(ROW_SIZE);
+    switch (idx % 4) {
+      case 0:
+        for (size_t offset = 0; offset < ROW_SIZE;) {
+          const array<byte, PIXEL_SIZE> pixel{
+              static_cast<byte>(random_byte(engine)),
+              static_cast<byte>(random_byte(engine)),
+              static_cast<byte>(random_byte(engine))};
+          const size_t run{1 + random_pixel(engine) % 40};
+          for (size_t count = 0; count < run && offset < ROW_SIZE; ++count) {
+            memcpy(data(row) + offset, data(pixel), PIXEL_SIZE);
+            offset += PIXEL_SIZE;
+          }
+        }
+        break;
+      case 1:
+        for (size_t offset = 0; offset < ROW_SIZE; ++offset) {
+          row[offset] = static_cast<byte>(offset / PIXEL_SIZE + idx);
+        }
+        break;
+      case 2:
+        row = rows.back();
+        for (size_t count = 0; count < 8; ++count) {
+          row[random_pixel(engine) * PIXEL_SIZE] =
+              static_cast<byte>(random_byte(engine));
+        }
+        break;
+      default:
+        for (auto& value : row) {
+          value = static_cast<byte>(random_byte(engine));
+        }
+        break;
+    }
+    rows.push_back(move(row));
+  }
+  return rows;
+}
+
+// What the peer is expected to send back for the pixels it has taken: the
+// scalar conversion, one bmp::Rgb666 after another as they lie in memory
+vector<byte> to_rgb666(const vector<byte>& pixels) {
+  vector<byte> converted;
+  for (size_t offset = 0; offset + PIXEL_SIZE <= size(pixels);
+       offset += PIXEL_SIZE) {
+    bmp::Bgr888 source;
+    memcpy(addressof(source), data(pixels) + offset, PIXEL_SIZE);
+    const bmp::Rgb666 pixel{color::ToRgb666(source)};
+    array<byte, sizeof(pixel)> raw;
+    memcpy(data(raw), addressof(pixel), sizeof(pixel));
+    converted.insert(end(converted), begin(raw), end(raw));
+  }
+  return converted;
+}
+
+// Rows of v1 blocks come first, the peer switches to v2 once it echoes it
+vector<byte> get_received(const emu::Peer& peer) {
+  vector<byte> received{peer.GetData()};
+  for (const auto& row : peer.GetRows()) {
+    received.insert(end(received), begin(row), end(row));
+  }
+  return received;
+}
+
+// The main loop of the viewer as far as the link goes: the link is set up
+// first, then rows are copied into buffers that are reused once their
+// tickets are released, and NAKs are retried until there is room for the
+// resent block
+class Firmware {
+ public:
+  Firmware(const vector<row_t>& rows,
+           parser_t& parser,
+           const io::LinkSetup::Settings& settings) noexcept
+      : m_rows{rows},
+        m_parser{parser},
+        m_setup{io::Receiver::GetInstance(), settings} {}
+
+  void Step() {
+    auto& transmitter{io::Transmitter::GetInstance()};
+    handle_naks();
+    while (const auto reply = m_parser.GetReplies().consume()) {
+      m_setup.OnReply(transmitter, *reply);
+    }
+    m_settled = m_setup.Step(transmitter, m_parser.GetData()) ==
+                io::LinkSetup::Status::Completed;
+    if (!m_settled) {
+      return;
+    }
+    send_rows();
+    while (const auto command = m_parser.GetCommands().consume()) {
+      m_commands.push_back(*command);
+    }
+    while (const auto value = m_parser.GetData().consume()) {
+      m_data.push_back(*value);
+    }
+  }
+
+  [[nodiscard]] bool IsSettled() const noexcept { return m_settled; }
+
+  [[nodiscard]] bool IsQueued() const noexcept {
+    return m_next_row == size(m_rows);
+  }
+
+  [[nodiscard]] const vector<cmd::Command>& GetCommands() const noexcept {
+    return m_commands;
+  }
+
+  [[nodiscard]] const vector<byte>& GetData() const noexcept {
+    return m_data;
+  }
+
+ private:
+  void handle_naks() {
+    auto& transmitter{io::Transmitter::GetInstance()};
+    while (m_pending_nak ||
+           (m_pending_nak = m_parser.GetNaks().consume())) {
+      if (transmitter.Resend(*m_pending_nak) ==
+          io::Transmitter::ResendStatus::NoRoom) {
+        break;
+      }
+      m_pending_nak.reset();
+    }
+  }
+
+  void send_rows() {
+    auto& transmitter{io::Transmitter::GetInstance()};
+    while (!IsQueued()) {
+      auto& ticket{m_tickets[m_next_buffer]};
+      if (ticket && !transmitter.IsReleased(*ticket)) {
+        return;
+      }
+      if (m_next_row % ROWS_PER_FRAME == 0) {
+        transmitter.BeginFrame();
+      }
+      auto& buffer{m_buffers[m_next_buffer]};
+      memcpy(data(buffer), data(m_rows[m_next_row]), ROW_SIZE);
+      const auto queued{transmitter.SendRow(data(buffer), ROW_SIZE)};
+      if (!queued) {
+        return;
+      }
+      ticket = *queued;
+      m_next_buffer = (m_next_buffer + 1) % ROW_BUFFERS;
+      ++m_next_row;
+    }
+  }
+
+ private:
+  const vector<row_t>& m_rows;
+  parser_t& m_parser;
+  io::LinkSetup m_setup;
+  bool m_settled{false};
+  array<array<byte, ROW_SIZE>, ROW_BUFFERS> m_buffers{};
+  array<optional<io::Transmitter::ticket_t>, ROW_BUFFERS> m_tickets{};
+  size_t m_next_buffer{0};
+  size_t m_next_row{0};
+  optional<uint16_t> m_pending_nak;
+  vector<cmd::Command> m_commands;
+  vector<byte> m_data;
+};
+
+struct Result {
+  io::Transmitter::Statistics port;
+  emu::Peer::Statistics peer;
+  uint32_t corrupted;  // v2 blocks damaged on the return path
+  size_t peer_speed_idx;
+};
+
+struct Scenario {
+  string_view name;
+  emu::Settings settings;
+  // Negotiated with the peer as the viewer does, otherwise the mode, the
+  // rate, v2 and the row codec are set on both sides directly
+  bool setup;
+  io::Transmitter::Mode mode;
+  size_t speed_idx;
+  // Commands go to the peer as v1 blocks, which the peer drops while it
+  // looks for an intact v2 header, so only where the data lines are intact
+  bool commands;
+  void (*check)(const Result& result);
+};
+
+// Throughput is taken from the virtual time since the link was settled
+void report(string_view name,
+            size_t bytes_count,
+            emu::microseconds_t settled_at,
+            emu::microseconds_t delivered_at,
+            emu::microseconds_t returned_at) {
+  const auto rate{[&](size_t count, emu::microseconds_t at) {
+    return static_cast<double>(count) * 1000 /
+           static_cast<double>(at - settled_at);
+  }};
+  printf(
+      "%.*s: link settled in %.1f ms, %.1f kB/s to the peer, %.1f kB/s "
+      "back\n",
+      static_cast<int>(size(name)), data(name),
+      static_cast<double>(settled_at) / 1000, rate(bytes_count, delivered_at),
+      rate(bytes_count / PIXEL_SIZE * sizeof(bmp::Rgb666), returned_at));
+}
+
+Result run(const Scenario& scenario) {
+  mt19937 engine{scenario.settings.seed};
+  const vector<row_t> rows{make_rows(engine)};
+  const size_t bytes_count{size(rows) * ROW_SIZE};
+
+  emu::Emulator emulator{scenario.settings};
+  auto& peer{emulator.GetPeer()};
+  auto& transmitter{io::Transmitter::GetInstance()};
+  auto& receiver{io::Receiver::GetInstance()};
+  static parser_t parser;
+  receiver.Listen(&parser);
+  const bool setup{scenario.setup};
+  if (!setup) {
+    receiver.SetSpeed(scenario.speed_idx);
+    peer.SetSpeed(scenario.speed_idx);
+    transmitter.SetReturnLatency(
+        io::Receiver::GetNakLatency(scenario.speed_idx));
+    transmitter.SetProtocol(io::Transmitter::Protocol::V2);
+    transmitter.SetRowCodec(true);
+    CHECK(transmitter.SetMode(scenario.mode));
+  }
+
+  Firmware firmware{rows, parser, {setup, setup, setup, setup, TEST_TIMEOUT}};
+  bool commanded{false};
+  optional<emu::microseconds_t> settled_at, delivered_at, returned_at;
+  const auto is_done{[&] {
+    const bool exchanged{
+        (!scenario.commands ||
+         size(peer.GetCommands()) == size(COMMANDS_SENT)) &&
+        size(firmware.GetCommands()) == 1};
+    return firmware.IsQueued() && transmitter.IsIdle() && delivered_at &&
+           returned_at && exchanged;
+  }};
+  while (!is_done()) {
+    firmware.Step();
+    // Nothing but the link setup goes either way before it's settled
+    if (!settled_at && firmware.IsSettled()) {
+      if (scenario.commands) {
+        transmitter.SendCommand(COMMANDS_SENT[0], COMMANDS_SENT[1]);
+      }
+      peer.SendCommand(COMMAND_RETURNED);
+      settled_at = emulator.Now();
+    }
+    const size_t received{size(peer.GetData()) +
+                          size(peer.GetRows()) * ROW_SIZE};
+    if (!delivered_at && received == bytes_count) {
+      delivered_at = emulator.Now();
+    }
+    if (!returned_at && size(firmware.GetData()) ==
+                            bytes_count / PIXEL_SIZE * sizeof(bmp::Rgb666)) {
+      returned_at = emulator.Now();
+    }
+    // A command overtakes the rows queued meanwhile
+    if (scenario.commands && !commanded &&
+        received >= ROWS_PER_FRAME / 2 * ROW_SIZE) {
+      transmitter.SendCommand(COMMANDS_SENT[2]);
+      commanded = true;
+    }
+    emulator.Step();
+    CHECK(emulator.Now() < TIME_LIMIT);
+  }
+
+  // A skipped row is replaced, and rows coded against it come out wrong
+  vector<byte> sent;
+  for (const auto& row : rows) {
+    sent.insert(end(sent), begin(row), end(row));
+  }
+  const vector<byte> delivered{get_received(peer)};
+  CHECK(size(delivered) == bytes_count);
+  CHECK(peer.GetStatistics().skipped > 0 || delivered == sent);
+  CHECK(peer.GetStatistics().decode_errors == 0);
+  // Whatever the peer has taken comes back converted
+  CHECK(firmware.GetData() == to_rgb666(delivered));
+  CHECK(emulator.GetLostBytes() == 0);
+  // Both sides have always changed the rate together
+  CHECK(receiver.GetLineErrors() == 0);
+  CHECK(receiver.GetSpeed() == peer.GetSpeed());
+  if (scenario.commands) {
+    CHECK(equal(begin(COMMANDS_SENT), end(COMMANDS_SENT),
+                begin(peer.GetCommands())));
+  }
+  CHECK(firmware.GetCommands().front() == COMMAND_RETURNED);
+  report(scenario.name, bytes_count, *settled_at, *delivered_at,
+         *returned_at);
+  return {transmitter.GetStatistics(), peer.GetStatistics(),
+          parser.GetCorruptedBlocks(), peer.GetSpeed()};
+}
+
+const array<Scenario, 9> SCENARIOS{{
+    {"clean",
+     {},
+     false,
+     io::Transmitter::Mode::Handshake,
+     0,
+     true,
+     [](const Result& result) {
+       CHECK(result.port.retries == 0 && result.port.resent == 0);
+       CHECK(result.peer.naks == 0 && result.corrupted == 0);
+       CHECK(result.peer.coded > 0 && result.peer.up_filtered > 0);
+       CHECK(result.peer.coded < result.peer.blocks);
+       // Down from the configured 100 us towards the peer's pace
+       CHECK(result.port.pass_delay < 10);
+     }},
+    {"overwrite",
+     {2, 1, 20, 0.05},
+     false,
+     io::Transmitter::Mode::Handshake,
+     0,
+     true,
+     [](const Result& result) {
+       CHECK(result.port.retries > 0 && result.port.resent == 0);
+     }},
+    {"nak",
+     {3, 2, 6, 0, 5e-4},
+     false,
+     io::Transmitter::Mode::Handshake,
+     0,
+     false,
+     [](const Result& result) {
+       CHECK(result.peer.damaged_headers + result.peer.damaged_payloads > 0);
+       CHECK(result.port.resent > 0 && result.corrupted == 0);
+       CHECK(result.port.skipped == 0);
+     }},
+    {"return_path",
+     {4, 2, 6, 0, 5e-4, 0.02, 20, 500},
+     false,
+     io::Transmitter::Mode::Handshake,
+     3,
+     false,
+     [](const Result& result) {
+       CHECK(result.port.resent > 0 && result.corrupted > 0);
+       CHECK(result.port.skipped == 0);
+     }},
+    // The peer is slower to NAK than the window lasts
+    {"expired",
+     {7, 2, 6, 0, 5e-4, 0, 40'000, 3000},
+     false,
+     io::Transmitter::Mode::Handshake,
+     0,
+     false,
+     [](const Result& result) {
+       CHECK(result.port.resent == 0 && result.port.skipped > 0);
+       CHECK(result.peer.skipped > 0 &&
+             result.peer.skipped <= result.port.skipped);
+     }},
+    {"burst",
+     {5},
+     false,
+     io::Transmitter::Mode::Burst,
+     0,
+     true,
+     [](const Result& result) {
+       CHECK(result.port.bursts > 0 && result.port.fallbacks == 0);
+       CHECK(io::Transmitter::GetInstance().GetMode() ==
+             io::Transmitter::Mode::Burst);
+     }},
+    {"burst_overwrite",
+     {6, 2, 6, 0.1},
+     false,
+     io::Transmitter::Mode::Burst,
+     0,
+     true,
+     [](const Result& result) {
+       // The port stays with the handshake after the first dropped burst
+       CHECK(result.port.fallbacks == 1);
+       CHECK(io::Transmitter::GetInstance().GetMode() ==
+             io::Transmitter::Mode::Handshake);
+     }},
+    // The peer takes up to the third rate, the fourth is rolled back
+    {"setup",
+     {8, 2, 6, 0, 0, 0, 20, 3000, {2, true, true, true}},
+     true,
+     io::Transmitter::Mode::Handshake,
+     0,
+     true,
+     [](const Result& result) {
+       CHECK(io::Receiver::GetInstance().GetSpeed() == 2);
+       CHECK(result.peer_speed_idx == 2);
+       CHECK(io::Transmitter::GetInstance().GetMode() ==
+             io::Transmitter::Mode::Burst);
+       CHECK(io::Transmitter::GetInstance().GetProtocol() ==
+             io::Transmitter::Protocol::V2);
+       CHECK(result.port.bursts > 0 && result.peer.coded > 0);
+     }},
+    // Every request times out, the rows go as v1 data over the handshake
+    {"silent_peer",
+     {9, 1, 20, 0.05, 0, 0, 20, 3000, {0, false, false, false}},
+     true,
+     io::Transmitter::Mode::Handshake,
+     0,
+     true,
+     [](const Result& result) {
+       CHECK(io::Receiver::GetInstance().GetSpeed() == 0);
+       CHECK(io::Transmitter::GetInstance().GetMode() ==
+             io::Transmitter::Mode::Handshake);
+       CHECK(io::Transmitter::GetInstance().GetProtocol() ==
+             io::Transmitter::Protocol::V1);
+       CHECK(result.port.retries > 0 && result.peer.blocks == 0);
+     }},
+}};
+}  // namespace
+
+// Each scenario runs in a process of its own, as the drivers are
+// singletons. The seed of a scenario may be replaced to try it further.
+int main(int argc, char* argv[]) {
+  CHECK(argc == 2 || argc == 3);
+  for (auto scenario : SCENARIOS) {
+    if (scenario.name == argv[1]) {
+      if (argc == 3) {
+        scenario.settings.seed =
+            static_cast<uint32_t>(strtoul(argv[2], nullptr, 10));
+      }
+      scenario.check(run(scenario));
+      return EXIT_SUCCESS;
+    }
+  }
+  CHECK(!"unknown scenario");
+  return EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,454 @@
+#include "peer.hpp"
+
+#include <tools/crc.hpp>
+
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace emu {
+namespace {
+constexpr size_t PIXEL_SIZE{3};
+constexpr uint8_t RUN_FLAG{0x80};
+constexpr size_t MIN_RUN{2};
+// A 16-bit bus word of R and G and one of B, each sent low byte first
+constexpr size_t CONVERTED_SIZE{4};
+constexpr uint8_t CHANNEL_MASK{0xFC};
+
+// Sequence ids wrap, so they are compared by their distance
+int16_t distance(uint16_t from, uint16_t to) noexcept {
+  return static_cast<int16_t>(to - from);
+}
+}  // namespace
+
+Peer::Peer(microseconds_t nak_delay,
+           microseconds_t nak_retry,
+           const Capabilities& capabilities) noexcept
+    : m_nak_delay{nak_delay},
+      m_nak_retry{nak_retry},
+      m_capabilities{capabilities},
+      m_reference(ROW_SIZE) {}
+
+void Peer::Take(byte value, microseconds_t now) {
+  switch (m_state) {
+    case State::Idle:
+      if (io::ExtendedHeader::IsExtended(value)) {
+        m_header.assign(1, value);
+        m_state = State::ExtendedHeader;
+      } else if ((m_block = io::BlockHeader::Deserialize(&value, 1))) {
+        m_state = State::Block;
+      }
+      break;
+    case State::Block:
+      take_block_byte(value);
+      break;
+    case State::ExtendedHeader:
+      take_extended_header(value, now);
+      break;
+    case State::ExtendedPayload:
+      take_extended_payload(value, now);
+      break;
+    case State::Hunt:
+      hunt(value, now);
+      break;
+  }
+}
+
+bool Peer::IsWithinChecked() const noexcept {
+  return m_state == State::ExtendedHeader ||
+         m_state == State::ExtendedPayload;
+}
+
+void Peer::Poll(microseconds_t now) {
+  for (auto& [sequence, missing] : m_missing) {
+    if (now >= missing.due) {
+      send_nak(sequence);
+      missing.due = now + m_nak_retry;
+    }
+  }
+}
+
+optional<microseconds_t> Peer::GetNextNak() const {
+  const auto earliest{min_element(
+      begin(m_missing), end(m_missing),
+      [](const auto& lhs, const auto& rhs) {
+        return lhs.second.due < rhs.second.due;
+      })};
+  if (earliest == end(m_missing)) {
+    return nullopt;
+  }
+  return earliest->second.due;
+}
+
+void Peer::SendCommand(cmd::Command command) {
+  const io::BlockHeader header{io::BlockHeader::Category::Command, 1};
+  m_return.push_back({static_cast<byte>(header.Serialize()), false});
+  m_return.push_back(
+      {static_cast<byte>(
+           static_cast<const io::Serializable<cmd::Command>&>(command)
+               .Serialize()),
+       false});
+}
+
+optional<Peer::LineByte> Peer::NextReturnByte() {
+  auto& queue{m_block_remaining == 0 && !m_naks.empty() ? m_naks : m_return};
+  if (queue.empty()) {
+    return nullopt;
+  }
+  const LineByte value{queue.front()};
+  queue.pop_front();
+  if (addressof(queue) == addressof(m_return)) {
+    if (m_block_remaining == 0) {
+      m_block_remaining =
+          io::BlockHeader::Deserialize(&value.value, 1).value().size + 1;
+    }
+    --m_block_remaining;
+  }
+  return value;
+}
+
+void Peer::SetSpeed(size_t speed_idx) noexcept {
+  m_speed_idx = speed_idx;
+}
+
+size_t Peer::GetSpeed() const noexcept {
+  return m_speed_idx;
+}
+
+const vector<vector<byte>>& Peer::GetRows() const noexcept {
+  return m_rows;
+}
+
+const vector<byte>& Peer::GetData() const noexcept {
+  return m_data;
+}
+
+const vector<cmd::Command>& Peer::GetCommands() const noexcept {
+  return m_commands;
+}
+
+auto Peer::GetStatistics() const noexcept -> const Statistics& {
+  return m_statistics;
+}
+
+void Peer::take_block_byte(byte value) {
+  const bool is_data{m_block->category == io::BlockHeader::Category::Data};
+  if (is_data) {
+    take_data(value);
+  } else {
+    take_command(
+        io::Serializable<cmd::Command>::Deserialize(&value, 1).value());
+  }
+  if (--m_block->size == 0) {
+    m_state = State::Idle;
+    if (is_data) {
+      send_converted();
+    }
+  }
+}
+
+void Peer::take_data(byte value) {
+  if (m_echo_remaining == 0) {
+    m_data.push_back(value);
+    convert(&value, 1);
+    return;
+  }
+  m_echo.push_back(value);
+  if (--m_echo_remaining == 0) {
+    send_data(data(m_echo), size(m_echo));
+    m_echo.clear();
+  }
+}
+
+// A new rate is taken at once and the test pattern is sent at it. The
+// burst test pattern comes as the next data and goes back as it is.
+void Peer::take_command(cmd::Command command) {
+  using Type = cmd::Command::Type;
+  const auto code{static_cast<uint8_t>(command.type)};
+  const auto speed_code{static_cast<uint8_t>(Type::LinkSpeed)};
+  if ((code & ~cmd::Command::LINK_SPEED_MASK) == speed_code) {
+    const size_t speed_idx{
+        static_cast<size_t>(code & cmd::Command::LINK_SPEED_MASK)};
+    if (speed_idx <= m_capabilities.max_speed_idx) {
+      m_speed_idx = speed_idx;
+      const auto& pattern{io::Receiver::TEST_PATTERN};
+      send_data(reinterpret_cast<const byte*>(data(pattern)), size(pattern));
+    }
+  } else if (command == Type::BurstMode) {
+    if (m_capabilities.burst) {
+      SendCommand(command);
+      m_echo_remaining = size(io::Receiver::TEST_PATTERN);
+    }
+  } else if (command == Type::ProtocolV2) {
+    if (m_capabilities.protocol_v2) {
+      SendCommand(command);
+    }
+  } else if (command == Type::RowCodec) {
+    if (m_capabilities.row_codec) {
+      SendCommand(command);
+    }
+  } else if (command.type != Type::LinkSpeedConfirm &&
+             command.type != Type::BurstModeConfirm) {
+    m_commands.push_back(command);
+  }
+}
+
+void Peer::take_extended_header(byte value, microseconds_t now) {
+  m_header.push_back(value);
+  if (size(m_header) < io::ExtendedHeader::SIZE) {
+    return;
+  }
+  if (const auto header = io::ExtendedHeader::Deserialize(data(m_header),
+                                                          size(m_header));
+      header) {
+    start_extended(*header, now);
+    return;
+  }
+  on_damaged_header(now);
+  m_header.erase(begin(m_header));
+  m_state = State::Hunt;
+}
+
+void Peer::take_extended_payload(byte value, microseconds_t now) {
+  m_payload.push_back(value);
+  if (size(m_payload) == m_extended->size) {
+    complete_extended(now);
+    m_state = State::Idle;
+  }
+}
+
+// The length of a damaged header is unknown, so its payload can't be
+// skipped: the next intact v2 header is looked for byte by byte
+void Peer::hunt(byte value, microseconds_t now) {
+  m_header.push_back(value);
+  for (;;) {
+    const auto first{find_if(begin(m_header), end(m_header),
+                             io::ExtendedHeader::IsExtended)};
+    m_header.erase(begin(m_header), first);
+    if (size(m_header) < io::ExtendedHeader::SIZE) {
+      return;
+    }
+    if (const auto header = io::ExtendedHeader::Deserialize(
+            data(m_header), io::ExtendedHeader::SIZE);
+        header) {
+      start_extended(*header, now);
+      return;
+    }
+    m_header.erase(begin(m_header));
+  }
+}
+
+void Peer::start_extended(const io::ExtendedHeader& header,
+                          microseconds_t now) {
+  m_extended = header;
+  m_payload.clear();
+  m_state = State::ExtendedPayload;
+  if (header.kind != io::ExtendedHeader::Kind::Data) {
+    return;
+  }
+  note_sequence(header.sequence, now);
+}
+
+// Blocks passed over since the highest one were lost with their headers
+void Peer::note_sequence(uint16_t sequence, microseconds_t now) {
+  if (!m_highest || distance(*m_highest, sequence) > 0) {
+    for (uint16_t lost = m_highest ? *m_highest + 1 : m_next_decoded;
+         lost != sequence; ++lost) {
+      mark_missing(lost, now);
+    }
+    m_highest = sequence;
+  }
+}
+
+// It could have been any block, but the next one is the likeliest. Older
+// ones are already missing and asked for again anyway.
+void Peer::on_damaged_header(microseconds_t now) {
+  ++m_statistics.damaged_headers;
+  mark_missing(
+      m_highest ? static_cast<uint16_t>(*m_highest + 1) : m_next_decoded, now);
+}
+
+void Peer::complete_extended(microseconds_t now) {
+  const auto& header{*m_extended};
+  const bool intact{crc::Update16(crc::CRC16_INIT, data(m_payload),
+                                  size(m_payload)) == header.crc};
+  if (header.kind == io::ExtendedHeader::Kind::Control) {
+    if (intact && m_payload[0] == static_cast<byte>(
+                                      io::ExtendedHeader::Control::Skip)) {
+      skip(header.sequence, now);
+    }
+    return;
+  }
+  if (header.kind != io::ExtendedHeader::Kind::Data) {
+    return;
+  }
+  if (!intact) {
+    ++m_statistics.damaged_payloads;
+    mark_missing(header.sequence, now);
+    return;
+  }
+  m_missing.erase(header.sequence);
+  if (distance(m_next_decoded, header.sequence) < 0 ||
+      m_received.count(header.sequence)) {
+    ++m_statistics.duplicates;
+    return;
+  }
+  ++m_statistics.blocks;
+  m_received.emplace(header.sequence, Received{header.coded, m_payload});
+  decode_ready();
+}
+
+void Peer::mark_missing(uint16_t sequence, microseconds_t now) {
+  m_missing[sequence] = Missing{now + m_nak_delay};
+}
+
+// The sender has given up on the block, so it isn't asked for any more.
+// The row before takes its place, which keeps the count of rows.
+void Peer::skip(uint16_t sequence, microseconds_t now) {
+  if (distance(m_next_decoded, sequence) < 0 ||
+      m_received.count(sequence) || m_skipped.count(sequence)) {
+    return;
+  }
+  ++m_statistics.skipped;
+  note_sequence(sequence, now);
+  m_missing.erase(sequence);
+  m_skipped.insert(sequence);
+  decode_ready();
+}
+
+// The up filter refers to the last row decoded, so rows are decoded in
+// sequence order only
+void Peer::decode_ready() {
+  for (;;) {
+    if (m_skipped.erase(m_next_decoded)) {
+      m_rows.push_back(m_reference);
+      convert(data(m_reference), size(m_reference));
+      send_converted();
+      ++m_next_decoded;
+      continue;
+    }
+    const auto it{m_received.find(m_next_decoded)};
+    if (it == end(m_received)) {
+      break;
+    }
+    auto row{decode(it->second)};
+    if (!row) {
+      ++m_statistics.decode_errors;
+      row.emplace();
+    }
+    m_reference = *row;
+    convert(data(*row), size(*row));
+    send_converted();
+    m_rows.push_back(move(*row));
+    m_received.erase(it);
+    ++m_next_decoded;
+  }
+}
+
+optional<vector<byte>> Peer::decode(const Received& block) {
+  if (!block.coded) {
+    return block.payload;
+  }
+  ++m_statistics.coded;
+
+  const auto& payload{block.payload};
+  const auto filter{static_cast<io::RowCodec::Filter>(payload[0])};
+  if (filter == io::RowCodec::Filter::Up) {
+    ++m_statistics.up_filtered;
+  } else if (filter != io::RowCodec::Filter::None &&
+             filter != io::RowCodec::Filter::Left) {
+    return nullopt;
+  }
+
+  vector<byte> row;
+  array<uint8_t, PIXEL_SIZE> previous{};
+  const auto put_pixel{[&](const byte* residual) {
+    const size_t offset{size(row)};
+    if (filter == io::RowCodec::Filter::Up &&
+        offset + PIXEL_SIZE > size(m_reference)) {
+      return false;
+    }
+    for (size_t idx = 0; idx < PIXEL_SIZE; ++idx) {
+      auto value{static_cast<uint8_t>(residual[idx])};
+      if (filter == io::RowCodec::Filter::Left) {
+        value = static_cast<uint8_t>(value + previous[idx]);
+      } else if (filter == io::RowCodec::Filter::Up) {
+        value = static_cast<uint8_t>(
+            value + static_cast<uint8_t>(m_reference[offset + idx]));
+      }
+      previous[idx] = value;
+      row.push_back(static_cast<byte>(value));
+    }
+    return true;
+  }};
+
+  for (size_t idx = 1; idx < size(payload);) {
+    const auto header{static_cast<uint8_t>(payload[idx++])};
+    const bool run{header >= RUN_FLAG};
+    const size_t count{run ? header - RUN_FLAG + MIN_RUN : header + 1u};
+    const size_t pixels{run ? 1 : count};
+    if (idx + pixels * PIXEL_SIZE > size(payload)) {
+      return nullopt;
+    }
+    for (size_t pixel = 0; pixel < count; ++pixel) {
+      const size_t from{run ? idx : idx + pixel * PIXEL_SIZE};
+      if (!put_pixel(data(payload) + from)) {
+        return nullopt;
+      }
+    }
+    idx += pixels * PIXEL_SIZE;
+  }
+  if (filter == io::RowCodec::Filter::Up && size(row) != size(m_reference)) {
+    return nullopt;
+  }
+  return row;
+}
+
+void Peer::send_nak(uint16_t sequence) {
+  ++m_statistics.naks;
+  const auto payload{static_cast<byte>(io::ExtendedHeader::Control::Nak)};
+  const io::ExtendedHeader header{io::ExtendedHeader::Kind::Control,
+                                  io::ExtendedHeader::CONTROL_LENGTH, sequence};
+  const auto raw{header.Serialize(&payload)};
+  for (size_t idx = 0; idx < size(raw); ++idx) {
+    m_naks.push_back({raw[idx], idx > 0});
+  }
+  m_naks.push_back({payload, true});
+}
+
+void Peer::send_data(const byte* data, size_t count) {
+  while (count > 0) {
+    const size_t chunk{min(count, io::BlockHeader::MAX_LENGTH)};
+    const io::BlockHeader header{io::BlockHeader::Category::Data, chunk};
+    m_return.push_back({static_cast<byte>(header.Serialize()), false});
+    for (size_t idx = 0; idx < chunk; ++idx) {
+      m_return.push_back({data[idx], false});
+    }
+    data += chunk;
+    count -= chunk;
+  }
+}
+
+// BGR888 pixels to the R, G and B bus words
+void Peer::convert(const byte* data, size_t count) {
+  for (size_t idx = 0; idx < count; ++idx) {
+    m_pixel.push_back(data[idx]);
+    if (size(m_pixel) < PIXEL_SIZE) {
+      continue;
+    }
+    const auto channel{[this](size_t offset) {
+      return m_pixel[offset] & static_cast<byte>(CHANNEL_MASK);
+    }};
+    const array<byte, CONVERTED_SIZE> converted{channel(1), channel(2),
+                                                byte{0}, channel(0)};
+    m_converted.insert(end(m_converted), begin(converted), end(converted));
+    m_pixel.clear();
+  }
+}
+
+void Peer::send_converted() {
+  send_data(data(m_converted), size(m_converted));
+  m_converted.clear();
+}
+}  // namespace emu
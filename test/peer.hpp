@@ -0,0 +1,153 @@
+#pragma once
+#include <transceiver/command.hpp>
+#include <transceiver/io.hpp>
+#include <transceiver/receiver.hpp>
+#include <transceiver/row_codec.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace emu {
+using microseconds_t = std::uint64_t;
+
+// What the peer accepts when the link is set up. Requests beyond that are
+// ignored, which declines them.
+struct Capabilities {
+  std::size_t max_speed_idx{std::size(io::Receiver::SPEEDS) - 1};
+  bool burst{true};
+  bool protocol_v2{true};
+  bool row_codec{true};
+};
+
+// The protocol side of the second board, as src/transceiver/PROTOCOL.md
+// describes it. Bytes taken from the parallel port are parsed into
+// v1 and v2 blocks, v2 data blocks are checked, decoded in sequence order
+// and damaged or missing ones are asked for again with NAKs until they
+// arrive or are skipped. Pixels are converted to RGB666 as ColorCompressor
+// does and sent back as v1 data in place of the display, so they can be
+// checked. Link requests are echoed as far as the capabilities go. What goes
+// back is queued for the return path byte by byte, a NAK goes right after
+// the v1 block being sent.
+class Peer {
+ public:
+  struct Statistics {
+    std::uint32_t blocks;            // intact v2 data blocks
+    std::uint32_t coded;             // of them packed by io::RowCodec
+    std::uint32_t up_filtered;       // of them referring to the last row
+    std::uint32_t damaged_headers;
+    std::uint32_t damaged_payloads;
+    std::uint32_t duplicates;        // resent after all
+    std::uint32_t naks;
+    std::uint32_t skipped;           // the row before is repeated instead
+    std::uint32_t decode_errors;     // must stay at zero
+  };
+
+  // Only the bytes of v2 blocks past the first one may be damaged on the
+  // line by the emulator: v1 blocks have no check at all, and a damaged
+  // first byte turns a v2 header into a v1 one
+  struct LineByte {
+    std::byte value;
+    bool checked;
+  };
+
+ public:
+  Peer(microseconds_t nak_delay,
+       microseconds_t nak_retry,
+       const Capabilities& capabilities) noexcept;
+
+  void Take(std::byte value, microseconds_t now);
+  // A byte taken now would belong to a checked part of a v2 block
+  [[nodiscard]] bool IsWithinChecked() const noexcept;
+  // Sends the NAKs that are due
+  void Poll(microseconds_t now);
+  [[nodiscard]] std::optional<microseconds_t> GetNextNak() const;
+
+  void SendCommand(cmd::Command command);
+  [[nodiscard]] std::optional<LineByte> NextReturnByte();
+  // The rate the peer sends at, an index in io::Receiver::SPEEDS. Set
+  // directly as if it had been negotiated.
+  void SetSpeed(std::size_t speed_idx) noexcept;
+  [[nodiscard]] std::size_t GetSpeed() const noexcept;
+
+  // Decoded v2 data blocks, one row each
+  [[nodiscard]] const std::vector<std::vector<std::byte>>& GetRows()
+      const noexcept;
+  // v1 data blocks, the burst test pattern aside
+  [[nodiscard]] const std::vector<std::byte>& GetData() const noexcept;
+  // Viewer commands, link requests aside
+  [[nodiscard]] const std::vector<cmd::Command>& GetCommands() const noexcept;
+  [[nodiscard]] const Statistics& GetStatistics() const noexcept;
+
+ private:
+  enum class State { Idle, Block, ExtendedHeader, ExtendedPayload, Hunt };
+
+  // BGR888 pixels across the panel of the second board
+  static constexpr std::size_t ROW_SIZE{240 * 3};
+
+  struct Missing {
+    microseconds_t due;  // of the next NAK
+  };
+
+  struct Received {
+    bool coded;
+    std::vector<std::byte> payload;
+  };
+
+  void take_block_byte(std::byte value);
+  void take_data(std::byte value);
+  void take_command(cmd::Command command);
+  void take_extended_header(std::byte value, microseconds_t now);
+  void take_extended_payload(std::byte value, microseconds_t now);
+  void hunt(std::byte value, microseconds_t now);
+  void start_extended(const io::ExtendedHeader& header, microseconds_t now);
+  void note_sequence(std::uint16_t sequence, microseconds_t now);
+  void on_damaged_header(microseconds_t now);
+  void complete_extended(microseconds_t now);
+  void mark_missing(std::uint16_t sequence, microseconds_t now);
+  void skip(std::uint16_t sequence, microseconds_t now);
+  void decode_ready();
+  [[nodiscard]] std::optional<std::vector<std::byte>> decode(
+      const Received& block);
+  void send_nak(std::uint16_t sequence);
+  void send_data(const std::byte* data, std::size_t count);
+  void convert(const std::byte* data, std::size_t count);
+  void send_converted();
+
+ private:
+  microseconds_t m_nak_delay;
+  microseconds_t m_nak_retry;
+  Capabilities m_capabilities;
+  std::size_t m_speed_idx{io::Receiver::DEFAULT_SPEED_IDX};
+  std::vector<std::byte> m_echo;  // of the burst test pattern
+  std::size_t m_echo_remaining{0};
+  State m_state{State::Idle};
+
+  std::optional<io::BlockHeader> m_block;
+  std::vector<std::byte> m_header;
+  std::optional<io::ExtendedHeader> m_extended;
+  std::vector<std::byte> m_payload;
+
+  std::optional<std::uint16_t> m_highest;
+  std::uint16_t m_next_decoded{0};
+  std::map<std::uint16_t, Missing> m_missing;
+  std::map<std::uint16_t, Received> m_received;
+  std::set<std::uint16_t> m_skipped;
+  std::vector<std::byte> m_reference;  // the screen starts black
+
+  std::vector<std::vector<std::byte>> m_rows;
+  std::vector<std::byte> m_data;
+  std::vector<std::byte> m_pixel;      // split between v1 blocks
+  std::vector<std::byte> m_converted;  // until the block is complete
+  std::vector<cmd::Command> m_commands;
+  std::deque<LineByte> m_return;  // v1 blocks
+  std::deque<LineByte> m_naks;
+  std::size_t m_block_remaining{0};  // of the v1 block being sent
+  Statistics m_statistics{};
+};
+}  // namespace emu
\ No newline at end of file